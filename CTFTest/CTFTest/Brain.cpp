@@ -1,11 +1,10 @@
 #include "Brain.h"
-#include "Agent.h"
-#include <QPointF>
 #include <cmath>
 
-Brain::Brain() : flagCaptured(false), score(0), proximityThreshold(250.0f), tagProximityThreshold(200.0f) {}
+Brain::Brain(const BrainParameters& parameters) : flagCaptured(false), score(0), proximityThreshold(parameters.proximityThreshold),
+    tagProximityThreshold(parameters.tagProximityThreshold), threatThreshold(parameters.threatThreshold) {}
 
-BrainDecision Brain::makeDecision(bool hasFlag, bool inHomeZone, float distanceToFlag, bool isTagged, bool enemyHasFlag, float distanceToNearestEnemy, bool isTagging, bool isStuckInMiddle, bool inSide) {
+BrainDecision Brain::makeDecision(bool hasFlag, bool inHomeZone, float distanceToFlag, bool isTagged, bool enemyHasFlag, float distanceToNearestEnemy, float threat, bool isTagging, bool isStuckInMiddle, bool inSide) {
     if (isTagged) {
         flagCaptured = false; // Reset flag captured status when tagged
         return BrainDecision::ReturnToHomeZone;
@@ -20,7 +19,7 @@ BrainDecision Brain::makeDecision(bool hasFlag, bool inHomeZone, float distanceT
             return BrainDecision::CaptureFlag;
         }
         else {
-            if (distanceToNearestEnemy < tagProximityThreshold) {
+            if (distanceToNearestEnemy < tagProximityThreshold || threat >= threatThreshold) {
                 // an enemy is nearby while carrying the flag
                 return BrainDecision::AvoidEnemy;
             }
@@ -64,7 +63,7 @@ BrainDecision Brain::makeDecision(bool hasFlag, bool inHomeZone, float distanceT
                     return BrainDecision::Explore;
                 }
                 else {
-                    if (distanceToNearestEnemy < tagProximityThreshold) {
+                    if (distanceToNearestEnemy < tagProximityThreshold || threat >= threatThreshold) {
                         // an enemy is nearby on the enemy side
                         return BrainDecision::AvoidEnemy;
                     }
@@ -1,10 +1,6 @@
 #ifndef BRAIN_H
 #define BRAIN_H
 
-#include <QString>
-#include <QPointF>
-#include "Agent.h"
-
 enum class BrainDecision {
     Explore,
     GrabFlag,
@@ -16,17 +12,30 @@ enum class BrainDecision {
     TagEnemy
 };
 
+// Thresholds an agent decides by, distances in pixels. The grab thresholds override the
+// decision tree: an agent without the flag goes for it when the flag is within grabFlagDistance
+// or no enemy is within grabEnemyClearance.
+struct BrainParameters {
+    float proximityThreshold = 250.0f;
+    float tagProximityThreshold = 200.0f;
+    float threatThreshold = 0.5f;
+    float grabFlagDistance = 250.0f;
+    float grabEnemyClearance = 100.0f;
+};
+
 class Brain {
 public:
-    Brain();
+    Brain(const BrainParameters& parameters = BrainParameters());
 
-    BrainDecision makeDecision(bool hasFlag, bool inHomeZone, float distanceToFlag, bool isTagged, bool enemyHasFlag, float distanceToNearestEnemy, bool isTagging, bool isStuckInMiddle, bool inSide);
+    // threat is the other team's influence at the agent, see InfluenceMap
+    BrainDecision makeDecision(bool hasFlag, bool inHomeZone, float distanceToFlag, bool isTagged, bool enemyHasFlag, float distanceToNearestEnemy, float threat, bool isTagging, bool isStuckInMiddle, bool inSide);
 
 private:
     bool flagCaptured;
     int score;
     float proximityThreshold;
     float tagProximityThreshold;
+    float threatThreshold;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "CompactPath.h"
+#include "OccupancyGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+CompactPath::CompactPath(const std::vector<std::pair<int, int>>& corners, int stepLength) {
+    for (const auto& corner : corners) {
+        std::pair<std::int16_t, std::int16_t> packed(static_cast<std::int16_t>(corner.first), static_cast<std::int16_t>(corner.second));
+        if (!this->corners.empty() && this->corners.back() == packed) {
+            continue;
+        }
+
+        std::uint32_t steps = 0;
+        if (!this->corners.empty()) {
+            // Steps of equal length along the segment, so the pace is the same in any direction
+            double dx = packed.first - this->corners.back().first;
+            double dy = packed.second - this->corners.back().second;
+            steps = stepCounts.back() + std::max<std::uint32_t>(1, static_cast<std::uint32_t>(std::ceil(std::sqrt(dx * dx + dy * dy) / stepLength - 1e-9)));
+        }
+        this->corners.push_back(packed);
+        stepCounts.push_back(steps);
+    }
+}
+
+void CompactPath::clear() {
+    corners.clear();
+    stepCounts.clear();
+}
+
+std::pair<int, int> CompactPath::operator[](std::size_t index) const {
+    std::size_t next = std::upper_bound(stepCounts.begin(), stepCounts.end(), static_cast<std::uint32_t>(index)) - stepCounts.begin();
+    if (next >= corners.size()) {
+        return { corners.back().first, corners.back().second };
+    }
+
+    const auto& from = corners[next - 1];
+    const auto& to = corners[next];
+    double t = static_cast<double>(index - stepCounts[next - 1]) / (stepCounts[next] - stepCounts[next - 1]);
+    return { from.first + static_cast<int>(std::lround((to.first - from.first) * t)),
+        from.second + static_cast<int>(std::lround((to.second - from.second) * t)) };
+}
+
+std::size_t CompactPath::getMemoryBytes() const {
+    return sizeof(CompactPath) + corners.capacity() * sizeof(corners[0]) + stepCounts.capacity() * sizeof(stepCounts[0]);
+}
+
+bool CompactPath::hasLineOfSight(const OccupancyGrid& grid, int fromX, int fromY, int toX, int toY) {
+    auto isClear = [&](int x, int y) {
+        if (x == toX && y == toY) {
+            return true;
+        }
+        int cell = grid.toCell(x, y);
+        return !grid.isOccupiedCell(cell) && grid.getOverlayCost(cell) == 0.0f;
+        };
+
+    // Walk every cell the segment touches, crossing whichever cell border comes first. A
+    // segment through a cell corner needs both cells beside it, so it never squeezes
+    // between two obstacles that touch diagonally.
+    int nx = std::abs(toX - fromX);
+    int ny = std::abs(toY - fromY);
+    int sx = toX > fromX ? 1 : -1;
+    int sy = toY > fromY ? 1 : -1;
+    int x = fromX;
+    int y = fromY;
+    for (int ix = 0, iy = 0; ix < nx || iy < ny;) {
+        int decision = (1 + 2 * ix) * ny - (1 + 2 * iy) * nx;
+        if (decision == 0) {
+            if (!isClear(x + sx, y) || !isClear(x, y + sy)) {
+                return false;
+            }
+            x += sx;
+            y += sy;
+            ++ix;
+            ++iy;
+        }
+        else if (decision < 0) {
+            x += sx;
+            ++ix;
+        }
+        else {
+            y += sy;
+            ++iy;
+        }
+
+        if (!isClear(x, y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::pair<int, int>> CompactPath::findCorners(const std::vector<std::pair<int, int>>& cells,
+    const OccupancyGrid& grid) {
+    if (cells.size() <= 2) {
+        return cells;
+    }
+
+    auto isVisible = [&](std::size_t from, std::size_t to) {
+        return hasLineOfSight(grid, cells[from].first, cells[from].second, cells[to].first, cells[to].second);
+        };
+
+    std::vector<std::pair<int, int>> corners;
+    corners.push_back(cells.front());
+    std::size_t anchor = 0;
+    while (anchor + 1 < cells.size()) {
+        // Furthest cell the anchor still sees, found by doubling the reach and then bisecting.
+        // Visibility along a path is not strictly monotone, so this may keep a corner a plain
+        // scan would skip, but every kept segment has been checked.
+        std::size_t visible = anchor + 1;
+        std::size_t hidden = cells.size();
+        for (std::size_t probe = anchor + 2; probe < cells.size(); probe = anchor + 2 * (probe - anchor)) {
+            if (!isVisible(anchor, probe)) {
+                hidden = probe;
+                break;
+            }
+            visible = probe;
+        }
+        if (hidden == cells.size() && visible != cells.size() - 1) {
+            if (isVisible(anchor, cells.size() - 1)) {
+                visible = cells.size() - 1;
+            }
+            else {
+                hidden = cells.size() - 1;
+            }
+        }
+        while (hidden - visible > 1) {
+            std::size_t middle = visible + (hidden - visible) / 2;
+            if (isVisible(anchor, middle)) {
+                visible = middle;
+            }
+            else {
+                hidden = middle;
+            }
+        }
+
+        corners.push_back(cells[visible]);
+        anchor = visible;
+    }
+    return corners;
+}
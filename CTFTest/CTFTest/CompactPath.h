@@ -0,0 +1,46 @@
+#ifndef COMPACTPATH_H
+#define COMPACTPATH_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+class OccupancyGrid;
+
+// A path kept as its corner waypoints only. Indexing still walks it in steps of a fixed
+// length, interpolating between corners, so code that advances one index per tick moves at
+// the same pace as along a path of single steps while storing a few corners instead of
+// every step. Coordinates must fit in 16 bits.
+class CompactPath {
+public:
+    CompactPath() = default;
+    CompactPath(const std::vector<std::pair<int, int>>& corners, int stepLength);
+
+    // String pulling on a grid path of adjacent cells: keeps the first and last cell and
+    // only those in between that the straight line from the previous kept cell cannot skip.
+    // A line may only cross free cells without overlay costs, so the smoothed path never
+    // passes an obstacle or a cell the search chose to avoid.
+    static std::vector<std::pair<int, int>> findCorners(const std::vector<std::pair<int, int>>& cells,
+        const OccupancyGrid& grid);
+
+    // True when the segment between the centres of two cells only touches cells that are
+    // free and carry no overlay cost, the end cells excepted
+    static bool hasLineOfSight(const OccupancyGrid& grid, int fromX, int fromY, int toX, int toY);
+
+    std::size_t size() const { return stepCounts.empty() ? 0 : stepCounts.back() + 1; }
+    bool empty() const { return corners.empty(); }
+    void clear();
+
+    // Point reached after index steps from the start
+    std::pair<int, int> operator[](std::size_t index) const;
+
+    const std::vector<std::pair<std::int16_t, std::int16_t>>& getCorners() const { return corners; }
+    std::size_t getMemoryBytes() const;
+
+private:
+    std::vector<std::pair<std::int16_t, std::int16_t>> corners;
+    std::vector<std::uint32_t> stepCounts; // steps from the start to each corner
+};
+
+#endif
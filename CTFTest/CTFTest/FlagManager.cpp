@@ -1,15 +1,19 @@
 #include "FlagManager.h"
-#include <QPainter>
-#include "Agent.h"
+#include <QBrush>
+#include <QPolygonF>
 
-FlagManager::FlagManager(QGraphicsItem* parent)
-    : QGraphicsItem(parent), carriedBy(nullptr) {
+FlagManager::FlagManager(const SimulationCore& core, Team team, QGraphicsItem* parent)
+    : QGraphicsPolygonItem(parent), core(core), team(team) {
+    // A pennant whose tip touches the stand
+    QPolygonF triangle;
+    triangle << QPointF(-10, -20) << QPointF(0, 0) << QPointF(10, -20);
+    setPolygon(triangle);
+    setBrush(team == Team::Blue ? Qt::blue : Qt::red);
+    sync();
 }
 
-void FlagManager::setCarriedBy(Agent* agent) {
-    carriedBy = agent;
+void FlagManager::sync() {
+    const FieldPoint& stand = core.getFlagPosition(team);
+    setPos(stand.x, stand.y);
+    setVisible(core.getFlagStatus(team).state == FlagState::AtBase);
 }
-
-Agent* FlagManager::getCarriedBy() const {
-    return carriedBy;
-}
\ No newline at end of file
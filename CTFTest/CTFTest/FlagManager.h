@@ -1,18 +1,27 @@
 #ifndef FLAGMANAGER_H
 #define FLAGMANAGER_H
 
-#include <QGraphicsItem>
+#include "SimulationCore.h"
+#include <QGraphicsPolygonItem>
 
-class Agent;
-
-class FlagManager : public QGraphicsItem {
+// Scene item for one team's flag. The core keeps the flag's state and its carrier; the item
+// stands on the flag's stand while the flag is at base and hides while it is carried or
+// dropped, and only reads the core back after every step.
+class FlagManager : public QGraphicsPolygonItem {
 public:
-    FlagManager(QGraphicsItem* parent = nullptr);
-    void setCarriedBy(Agent* agent);
-    Agent* getCarriedBy() const;
+    FlagManager(const SimulationCore& core, Team team, QGraphicsItem* parent = nullptr);
+
+    // Copies the flag's stand and state from the core into the item
+    void sync();
+
+    Team getTeam() const { return team; }
+    FlagState getState() const { return core.getFlagStatus(team).state; }
+    // Index of the agent carrying the flag, -1 unless it is carried
+    int getCarriedBy() const { return core.getFlagStatus(team).carrier; }
 
 private:
-    Agent* carriedBy;
+    const SimulationCore& core;
+    Team team;
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,301 @@
+#include "FlowField.h"
+#include "OccupancyGrid.h"
+#include "Pathfinder.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+    const float unreachable = std::numeric_limits<float>::infinity();
+    const int dx[] = { -1, 0, 1, 0 };
+    const int dy[] = { 0, -1, 0, 1 };
+}
+
+FlowField::FlowField(const OccupancyGrid& grid, int goalX, int goalY)
+    : grid(grid), width(grid.getWidth()), height(grid.getHeight()), goalCell(grid.toCell(goalX, goalY)),
+    epoch(0), appliedChanges(0), lastUpdateCount(0),
+    distance(static_cast<std::size_t>(width) * height, unreachable),
+    parent(static_cast<std::size_t>(width) * height, -1) {
+    rebuild();
+}
+
+bool FlowField::isPassable(int cell) const {
+    // The goal stays passable even when occupied, like in Pathfinder's grid search
+    return cell == goalCell || !grid.isOccupiedCell(cell);
+}
+
+float FlowField::getStepCost(int cell) const {
+    return static_cast<float>(Pathfinder::getStepCost(grid, cell));
+}
+
+void FlowField::update() {
+    const std::vector<int>& changedCells = grid.getChangedCells();
+    if (grid.getEpoch() == epoch) {
+        // Overlay costs can still change within the epoch the field last saw
+        if (changedCells.size() > appliedChanges) {
+            repair(appliedChanges);
+        }
+    }
+    else if (grid.getEpoch() == epoch + 1) {
+        repair(0);
+    }
+    else {
+        // The changes of a skipped epoch are gone, so there is nothing to repair from
+        rebuild();
+    }
+    epoch = grid.getEpoch();
+    appliedChanges = changedCells.size();
+}
+
+void FlowField::rebuild() {
+    std::fill(distance.begin(), distance.end(), unreachable);
+    std::fill(parent.begin(), parent.end(), -1);
+    openSet.clear();
+    lastUpdateCount = 0;
+
+    distance[goalCell] = 0.0f;
+    push(goalCell);
+    propagate();
+
+    epoch = grid.getEpoch();
+    appliedChanges = grid.getChangedCells().size();
+}
+
+void FlowField::repair(std::size_t firstChange) {
+    const std::vector<int>& changedCells = grid.getChangedCells();
+    openSet.clear();
+    invalidated.clear();
+    lastUpdateCount = 0;
+
+    // Everything routed through a changed cell paid that cell's old cost, so it loses its
+    // distance. A cell that became blocked loses its own distance as well.
+    for (std::size_t i = firstChange; i < changedCells.size(); ++i) {
+        int cell = changedCells[i];
+        if (!isPassable(cell) && distance[cell] != unreachable) {
+            distance[cell] = unreachable;
+            parent[cell] = -1;
+            invalidated.push_back(cell);
+        }
+        invalidate(cell);
+    }
+
+    // Reseed the lost cells from their neighbours that kept a distance, and let the changed
+    // cells relax their neighbours in case they became cheaper to step onto
+    for (std::size_t i = 0; i < invalidated.size(); ++i) {
+        int cell = invalidated[i];
+        int x = cell % width;
+        int y = cell / width;
+        for (int d = 0; d < 4; ++d) {
+            int newX = x + dx[d];
+            int newY = y + dy[d];
+            if (grid.isValidPosition(newX, newY) && distance[newY * width + newX] != unreachable) {
+                push(newY * width + newX);
+            }
+        }
+    }
+    for (std::size_t i = firstChange; i < changedCells.size(); ++i) {
+        int cell = changedCells[i];
+        if (isPassable(cell) && distance[cell] == unreachable) {
+            // A freed cell, reachable through any neighbour that has a distance
+            int x = cell % width;
+            int y = cell / width;
+            for (int d = 0; d < 4; ++d) {
+                int newX = x + dx[d];
+                int newY = y + dy[d];
+                if (grid.isValidPosition(newX, newY) && distance[newY * width + newX] != unreachable) {
+                    push(newY * width + newX);
+                }
+            }
+        }
+        else if (distance[cell] != unreachable) {
+            push(cell);
+        }
+    }
+
+    propagate();
+}
+
+void FlowField::invalidate(int cell) {
+    // Walks the subtree of cells whose route to the goal leads through the given cell
+    std::size_t first = invalidated.size();
+    std::vector<int>& pending = invalidated;
+    int current = cell;
+    std::size_t next = first;
+    for (;;) {
+        int x = current % width;
+        int y = current / width;
+        for (int d = 0; d < 4; ++d) {
+            int newX = x + dx[d];
+            int newY = y + dy[d];
+            if (!grid.isValidPosition(newX, newY)) {
+                continue;
+            }
+
+            int child = newY * width + newX;
+            if (parent[child] == current && !reparent(child, current)) {
+                distance[child] = unreachable;
+                parent[child] = -1;
+                pending.push_back(child);
+            }
+        }
+
+        if (next == pending.size()) {
+            break;
+        }
+        current = pending[next++];
+    }
+}
+
+bool FlowField::reparent(int cell, int lostParent) {
+    // Open fields are full of equal-cost routes, so most cells behind a changed cell can keep
+    // their distance through another neighbour. A neighbour whose own distance is about to be
+    // lost is fine too, the walk reaches this cell again through it.
+    int x = cell % width;
+    int y = cell / width;
+    for (int d = 0; d < 4; ++d) {
+        int newX = x + dx[d];
+        int newY = y + dy[d];
+        if (!grid.isValidPosition(newX, newY)) {
+            continue;
+        }
+
+        int neighborCell = newY * width + newX;
+        if (neighborCell != lostParent && distance[neighborCell] != unreachable &&
+            distance[neighborCell] + getStepCost(neighborCell) == distance[cell]) {
+            parent[cell] = neighborCell;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FlowField::push(int cell) {
+    openSet.emplace_back(distance[cell], cell);
+    std::push_heap(openSet.begin(), openSet.end(), std::greater<std::pair<float, int>>());
+}
+
+void FlowField::propagate() {
+    while (!openSet.empty()) {
+        std::pop_heap(openSet.begin(), openSet.end(), std::greater<std::pair<float, int>>());
+        auto [cellDistance, cell] = openSet.back();
+        openSet.pop_back();
+        if (cellDistance > distance[cell]) {
+            continue; // stale entry
+        }
+
+        ++lastUpdateCount;
+
+        // Stepping onto this cell from a neighbour costs this cell's step cost
+        float throughCell = cellDistance + getStepCost(cell);
+        int x = cell % width;
+        int y = cell / width;
+        for (int d = 0; d < 4; ++d) {
+            int newX = x + dx[d];
+            int newY = y + dy[d];
+            if (!grid.isValidPosition(newX, newY)) {
+                continue;
+            }
+
+            int neighborCell = newY * width + newX;
+            if (throughCell < distance[neighborCell] && isPassable(neighborCell)) {
+                distance[neighborCell] = throughCell;
+                parent[neighborCell] = cell;
+                push(neighborCell);
+            }
+        }
+    }
+}
+
+bool FlowField::nextStep(int x, int y, std::pair<int, int>& step) const {
+    if (!grid.isValidPosition(x, y)) {
+        return false;
+    }
+
+    int cell = y * width + x;
+    if (cell == goalCell) {
+        return false;
+    }
+    if (parent[cell] != -1) {
+        step = { parent[cell] % width, parent[cell] / width };
+        return true;
+    }
+
+    // Occupied cells have no distance of their own, pick the best neighbour directly
+    float best = unreachable;
+    for (int d = 0; d < 4; ++d) {
+        int newX = x + dx[d];
+        int newY = y + dy[d];
+        if (!grid.isValidPosition(newX, newY)) {
+            continue;
+        }
+
+        int neighborCell = newY * width + newX;
+        if (distance[neighborCell] == unreachable) {
+            continue;
+        }
+
+        float cost = distance[neighborCell] + getStepCost(neighborCell);
+        if (cost < best) {
+            best = cost;
+            step = { newX, newY };
+        }
+    }
+    return best != unreachable;
+}
+
+std::vector<std::pair<int, int>> FlowField::tracePath(int x, int y) const {
+    std::vector<std::pair<int, int>> path;
+    if (!grid.isValidPosition(x, y)) {
+        return path;
+    }
+
+    path.push_back({ x, y });
+    std::pair<int, int> step;
+    if (!nextStep(x, y, step)) {
+        if (y * width + x != goalCell) {
+            path.clear();
+        }
+        return path;
+    }
+
+    for (int cell = step.second * width + step.first; cell != -1; cell = parent[cell]) {
+        path.push_back({ cell % width, cell / width });
+    }
+    return path;
+}
+
+float FlowField::getDistance(int x, int y) const {
+    return grid.isValidPosition(x, y) ? distance[y * width + x] : unreachable;
+}
+
+FlowFieldService::FlowFieldService(const OccupancyGrid& grid, std::uint32_t idleEpochs)
+    : grid(grid), idleEpochs(idleEpochs) {}
+
+const FlowField* FlowFieldService::getField(int goalX, int goalY) {
+    if (!grid.isValidPosition(goalX, goalY)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = fields[grid.toCell(goalX, goalY)];
+    if (!entry.field) {
+        entry.field = std::make_unique<FlowField>(grid, goalX, goalY);
+    }
+    else {
+        entry.field->update();
+    }
+    entry.lastUsedEpoch = grid.getEpoch();
+    return entry.field.get();
+}
+
+void FlowFieldService::sync() {
+    for (auto it = fields.begin(); it != fields.end();) {
+        if (grid.getEpoch() - it->second.lastUsedEpoch > idleEpochs) {
+            it = fields.erase(it);
+        }
+        else {
+            it->second.field->update();
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <vector>
+#include <utility>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+class OccupancyGrid;
+
+// Dijkstra map toward one goal cell: every cell holds its path cost to the goal and the
+// neighbour it reaches the goal through, using the same step costs as Pathfinder. Any agent
+// can read its next step from it, so agents heading for the same goal share one search.
+class FlowField {
+public:
+    FlowField(const OccupancyGrid& grid, int goalX, int goalY);
+
+    // Brings the field up to date with the grid. Only the cells whose cost depends on a
+    // changed grid cell are recomputed, unless an epoch was missed and it must rebuild.
+    void update();
+
+    // Best neighbouring cell to step onto from (x, y). False at the goal or when the goal
+    // cannot be reached. The cell itself may be occupied, e.g. by the agent asking.
+    bool nextStep(int x, int y, std::pair<int, int>& step) const;
+
+    // Cells from (x, y) to the goal inclusive, empty when the goal cannot be reached
+    std::vector<std::pair<int, int>> tracePath(int x, int y) const;
+
+    float getDistance(int x, int y) const;
+    int getGoalX() const { return goalCell % width; }
+    int getGoalY() const { return goalCell / width; }
+    std::size_t getLastUpdateCount() const { return lastUpdateCount; }
+
+private:
+    bool isPassable(int cell) const;
+    float getStepCost(int cell) const;
+    void rebuild();
+    void repair(std::size_t firstChange);
+    void invalidate(int cell);
+    bool reparent(int cell, int lostParent);
+    void push(int cell);
+    void propagate();
+
+    const OccupancyGrid& grid;
+    int width;
+    int height;
+    int goalCell;
+    std::uint32_t epoch;
+    std::size_t appliedChanges;     // changed cells of the current epoch already applied
+    std::size_t lastUpdateCount;    // cells settled by the last update
+    std::vector<float> distance;
+    std::vector<int> parent;
+    std::vector<int> invalidated;
+    std::vector<std::pair<float, int>> openSet;
+};
+
+// Fields toward the goals agents keep returning to (flags and bases), keyed by goal cell.
+// Teams heading for the same cell share its field. GameManager syncs them once per tick
+// after rebuilding the grid, and fields nobody asked for in a while are dropped.
+class FlowFieldService {
+public:
+    explicit FlowFieldService(const OccupancyGrid& grid, std::uint32_t idleEpochs = 600);
+
+    // Field toward the goal, built on first use. Null when the goal is off the grid. Locks
+    // the service, so threads planning against the same grid can share it after a sync.
+    const FlowField* getField(int goalX, int goalY);
+
+    void sync();
+    std::size_t getFieldCount() const { return fields.size(); }
+
+private:
+    struct Entry {
+        std::unique_ptr<FlowField> field;
+        std::uint32_t lastUsedEpoch;
+    };
+
+    const OccupancyGrid& grid;
+    std::uint32_t idleEpochs;
+    std::unordered_map<int, Entry> fields;
+    std::mutex mutex;
+};
+
+#endif
@@ -1,7 +1,6 @@
 #include "GameManager.h"
 #include "Agent.h"
 #include <QPainter>
-#include <QPolygon>
 #include <QRandomGenerator>
 #include <QGraphicsScene>
 #include <QGraphicsRectItem>
@@ -9,13 +8,14 @@
 #include <QGraphicsTextItem>
 #include <QFont>
 #include <QTimer>
-#include <QRandomGenerator>
 #include <memory>
+#include <algorithm>
 
 int GameManager::blueScore = 0;
 int GameManager::redScore = 0;
 
-GameManager::GameManager(QWidget* parent) : QGraphicsView(parent), gameFieldWidth(800), gameFieldHeight(600) {
+GameManager::GameManager(QWidget* parent, int pathCellSize) : QGraphicsView(parent), gameFieldWidth(800), gameFieldHeight(600),
+    core(gameFieldWidth, gameFieldHeight, pathCellSize, QRandomGenerator::global()->generate()) {
     setFixedSize(800, 600);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -64,6 +64,7 @@ void GameManager::setupScene() {
     redFlagPos = redZone->rect().center();
     blueBasePos = QPointF(50, 280);
     redBasePos = QPointF(750, 280);
+    updateAgentPositions();
 
     // Add team areas fields
     QGraphicsRectItem* blueArea = new QGraphicsRectItem(5, 10, 400, 580);
@@ -74,42 +75,55 @@ void GameManager::setupScene() {
     redArea->setPen(QPen(Qt::red, 2));
     scene->addItem(redArea);
 
-    // Create flags
-    QGraphicsPolygonItem* blueFlag = new QGraphicsPolygonItem();
-    blueFlag->setData(QGraphicsItem::UserType, QGraphicsItem::UserType + 1);
-    QPolygon blueTriangle;
-    qreal blueFlagCenter = blueZone->rect().center().y();
-    blueTriangle << QPoint(blueFlagPos.x() - 10, blueFlagCenter - 20)
-        << QPoint(blueFlagPos.x(), blueFlagCenter)
-        << QPoint(blueFlagPos.x() + 10, blueFlagCenter - 20);
-    blueFlag->setPolygon(blueTriangle);
-    blueFlag->setBrush(Qt::blue);
+    // Create flags, which stay in the scene for good and follow the core's flags
+    blueFlag = new FlagManager(core, Team::Blue);
     scene->addItem(blueFlag);
 
-    QGraphicsPolygonItem* redFlag = new QGraphicsPolygonItem();
-    redFlag->setData(QGraphicsItem::UserType, QGraphicsItem::UserType + 1);
-    QPolygon redTriangle;
-    qreal redFlagCenter = redZone->rect().center().y();
-    redTriangle << QPoint(redFlagPos.x() - 10, redFlagCenter - 20)
-        << QPoint(redFlagPos.x(), redFlagCenter)
-        << QPoint(redFlagPos.x() + 10, redFlagCenter - 20);
-    redFlag->setPolygon(redTriangle);
-    redFlag->setBrush(Qt::red);
+    redFlag = new FlagManager(core, Team::Red);
     scene->addItem(redFlag);
 }
 
+void GameManager::addAgent(Team team, const QPointF& position) {
+    int index = core.addAgent(team, FieldPoint{ position.x(), position.y() });
+    auto agent = std::make_shared<Agent>(core, index);
+    scene->addItem(agent.get());
+    (team == Team::Blue ? blueAgents : redAgents).push_back(agent);
+}
+
+QPointF GameManager::randomPosition(int width, int height) {
+    // Drawn one after the other, so the same seed places agents the same way on any compiler
+    int x = core.randomBounded(width);
+    int y = core.randomBounded(height);
+    return QPointF(x, y);
+}
+
+void GameManager::clearAgents() {
+    for (const auto& agent : blueAgents) {
+        scene->removeItem(agent.get());
+    }
+    blueAgents.clear();
+
+    for (const auto& agent : redAgents) {
+        scene->removeItem(agent.get());
+    }
+    redAgents.clear();
+
+    // Without agents both flags are back on their stands
+    core.clearAgents();
+    syncFlags();
+}
+
+void GameManager::syncFlags() {
+    blueFlag->sync();
+    redFlag->sync();
+}
+
 void GameManager::setupAgents() {
     // Create agents
     for (int i = 0; i < 4; ++i) {
-        auto blueAgent = std::make_shared<Agent>(Qt::blue, redFlagPos, blueBasePos, gameFieldWidth, gameFieldHeight, this);
-        blueAgent->setPos(QRandomGenerator::global()->bounded(100), QRandomGenerator::global()->bounded(500));
-        scene->addItem(blueAgent.get());
-        blueAgents.push_back(blueAgent);
-
-        auto redAgent = std::make_shared<Agent>(Qt::red, blueFlagPos, redBasePos, gameFieldWidth, gameFieldHeight, this);
-        redAgent->setPos(800 - QRandomGenerator::global()->bounded(100), QRandomGenerator::global()->bounded(500));
-        scene->addItem(redAgent.get());
-        redAgents.push_back(redAgent);
+        addAgent(Team::Blue, randomPosition(100, 500));
+        QPointF offset = randomPosition(100, 500);
+        addAgent(Team::Red, QPointF(800 - offset.x(), offset.y()));
     }
 }
 
@@ -147,37 +161,33 @@ void GameManager::gameLoop() {
     timeRemaining -= elapsedTime / 1000.0;
     updateTimeDisplay();
 
-    // Collect the positions of all agents
-    std::vector<std::pair<int, int>> otherAgentsPositions;
-    for (const auto& agent : blueAgents) {
-        otherAgentsPositions.emplace_back(agent->pos().x(), agent->pos().y());
-    }
-    for (const auto& agent : redAgents) {
-        otherAgentsPositions.emplace_back(agent->pos().x(), agent->pos().y());
-    }
+    // Advance the game, then bring the scene up to date with it
+    core.step(elapsedTime);
 
-    // Update the agents
-    std::vector<Agent*> allAgents;
     for (const auto& agent : blueAgents) {
-        agent->update(otherAgentsPositions, allAgents, elapsedTime);
-        allAgents.push_back(agent.get());
+        agent->sync();
     }
-
     for (const auto& agent : redAgents) {
-        agent->update(otherAgentsPositions, allAgents, elapsedTime);
-        allAgents.push_back(agent.get());
+        agent->sync();
     }
+    syncFlags();
 
+    if (blueScore != core.getScore(Team::Blue) || redScore != core.getScore(Team::Red)) {
+        blueScore = core.getScore(Team::Blue);
+        redScore = core.getScore(Team::Red);
+        updateScoreDisplay();
+    }
 
     // Update only the changed portions of the scene
+    const AgentTable& agents = core.getAgents();
     for (const auto& agent : blueAgents) {
-        if (!agent->isPathEmpty()) {
+        if (!agents.paths[agent->getIndex()].empty()) {
             viewport()->update(agent->boundingRect().toRect());
         }
     }
 
     for (const auto& agent : redAgents) {
-        if (!agent->isPathEmpty()) {
+        if (!agents.paths[agent->getIndex()].empty()) {
             viewport()->update(agent->boundingRect().toRect());
         }
     }
@@ -203,6 +213,7 @@ void GameManager::stopGame() {
 
 void GameManager::declareWinner() {
     QGraphicsTextItem* winnerText = new QGraphicsTextItem();
+    winnerTextItem = winnerText;
     winnerText->setFont(QFont("Arial", 24));
     winnerText->setPos(300, 250);
 
@@ -239,15 +250,7 @@ void GameManager::runTestCase1() {
 
 void GameManager::runTestCase2(int agentCount) {
     // Clear the existing agents
-    for (const auto& agent : blueAgents) {
-        scene->removeItem(agent.get());
-    }
-    blueAgents.clear();
-
-    for (const auto& agent : redAgents) {
-        scene->removeItem(agent.get());
-    }
-    redAgents.clear();
+    clearAgents();
 
     // Calculate the number of blue and red agents
     int blueCount = agentCount / 2;
@@ -255,20 +258,16 @@ void GameManager::runTestCase2(int agentCount) {
 
     // Set up the new agents
     for (int i = 0; i < blueCount; ++i) {
-        auto blueAgent = std::make_shared<Agent>(Qt::blue, redFlagPos, blueBasePos, gameFieldWidth, gameFieldHeight, this);
-        blueAgent->setPos(QRandomGenerator::global()->bounded(100), QRandomGenerator::global()->bounded(500));
-        scene->addItem(blueAgent.get());
-        blueAgents.push_back(blueAgent);
+        addAgent(Team::Blue, randomPosition(100, 500));
     }
 
     for (int i = 0; i < redCount; ++i) {
-        auto redAgent = std::make_shared<Agent>(Qt::red, blueFlagPos, redBasePos, gameFieldWidth, gameFieldHeight, this);
-        redAgent->setPos(800 - QRandomGenerator::global()->bounded(100), QRandomGenerator::global()->bounded(500));
-        scene->addItem(redAgent.get());
-        redAgents.push_back(redAgent);
+        QPointF offset = randomPosition(100, 500);
+        addAgent(Team::Red, QPointF(800 - offset.x(), offset.y()));
     }
 
     // Reset the scores
+    core.resetScores();
     blueScore = 0;
     redScore = 0;
     updateScoreDisplay();
@@ -291,32 +290,12 @@ void GameManager::runTestCase2(int agentCount) {
 void GameManager::runTestCase3() {
     // Change the position of team zones and flags
 
-    // Remove the old flags
-    QList<QGraphicsItem*> items = scene->items();
-    for (QGraphicsItem* item : items) {
-        if (item->type() == QGraphicsPolygonItem::Type) {
-            scene->removeItem(item);
-            delete item;
-        }
-    }
-
-    // Create new flags
-    QGraphicsPolygonItem* blueFlag = new QGraphicsPolygonItem();
-    QGraphicsPolygonItem* redFlag = new QGraphicsPolygonItem();
-
     // Move the blue team zone to the top-left corner
     QRectF blueZoneRect(0, 0, 100, 100);
     blueZone->setRect(blueZoneRect);
 
     // Move the blue flag to the center of the new team zone position
     QPointF blueFlagPos = blueZoneRect.center();
-    QPolygon blueTriangle;
-    blueTriangle << QPoint(blueFlagPos.x() - 10, blueFlagPos.y() - 20)
-        << QPoint(blueFlagPos.x(), blueFlagPos.y())
-        << QPoint(blueFlagPos.x() + 10, blueFlagPos.y() - 20);
-    blueFlag->setPolygon(blueTriangle);
-    blueFlag->setBrush(Qt::blue);
-    scene->addItem(blueFlag);
 
     // Move the red team zone to the bottom-right corner
     QRectF redZoneRect(700, 500, 100, 100);
@@ -324,13 +303,6 @@ void GameManager::runTestCase3() {
 
     // Move the red flag to the center of the new team zone position
     QPointF redFlagPos = redZoneRect.center();
-    QPolygon redTriangle;
-    redTriangle << QPoint(redFlagPos.x() - 10, redFlagPos.y() - 20)
-        << QPoint(redFlagPos.x(), redFlagPos.y())
-        << QPoint(redFlagPos.x() + 10, redFlagPos.y() - 20);
-    redFlag->setPolygon(redTriangle);
-    redFlag->setBrush(Qt::red);
-    scene->addItem(redFlag);
 
     // Update the flag positions
     this->blueFlagPos = blueFlagPos;
@@ -339,32 +311,19 @@ void GameManager::runTestCase3() {
     // Update the base positions
     blueBasePos = QPointF(50, 50);
     redBasePos = QPointF(750, 550);
+    updateAgentPositions();
 
     // Clear the existing agents
-    for (const auto& agent : blueAgents) {
-        scene->removeItem(agent.get());
-    }
-    blueAgents.clear();
-
-    for (const auto& agent : redAgents) {
-        scene->removeItem(agent.get());
-    }
-    redAgents.clear();
+    clearAgents();
 
     // Create new agents with the updated flag and base positions
     for (int i = 0; i < 4; ++i) {
-        auto blueAgent = std::make_shared<Agent>(Qt::blue, redFlagPos, blueBasePos, gameFieldWidth, gameFieldHeight, this);
-        blueAgent->setPos(QRandomGenerator::global()->bounded(50), QRandomGenerator::global()->bounded(50));
-        scene->addItem(blueAgent.get());
-        blueAgents.push_back(blueAgent);
-
-        auto redAgent = std::make_shared<Agent>(Qt::red, blueFlagPos, redBasePos, gameFieldWidth, gameFieldHeight, this);
-        redAgent->setPos(750 - QRandomGenerator::global()->bounded(50), 550 - QRandomGenerator::global()->bounded(50));
-        scene->addItem(redAgent.get());
-        redAgents.push_back(redAgent);
+        addAgent(Team::Blue, randomPosition(50, 50));
+        addAgent(Team::Red, QPointF(750, 550) - randomPosition(50, 50));
     }
 
     // Reset the scores
+    core.resetScores();
     blueScore = 0;
     redScore = 0;
     updateScoreDisplay();
@@ -413,22 +372,16 @@ void GameManager::runTestCase4() {
     // Update base positions
     blueBasePos = QPointF(70, 280);
     redBasePos = QPointF(730, 280);
+    updateAgentPositions();
 
     // Clear the existing agents
-    for (const auto& agent : blueAgents) {
-        scene->removeItem(agent.get());
-    }
-    blueAgents.clear();
-
-    for (const auto& agent : redAgents) {
-        scene->removeItem(agent.get());
-    }
-    redAgents.clear();
+    clearAgents();
 
     // Create new agents with the updated flag and base positions
     setupAgents();
 
     // Reset the scores
+    core.resetScores();
     blueScore = 0;
     redScore = 0;
     updateScoreDisplay();
@@ -450,33 +403,28 @@ void GameManager::runTestCase4() {
 
 void GameManager::runTestCase5() {
     // Clear the existing agents
-    for (const auto& agent : blueAgents) {
-        scene->removeItem(agent.get());
-    }
-    blueAgents.clear();
-
-    for (const auto& agent : redAgents) {
-        scene->removeItem(agent.get());
-    }
-    redAgents.clear();
+    clearAgents();
 
     // Create new agents with the default positions
     setupAgents();
 
     // Disable some agents randomly
     for (const auto& agent : blueAgents) {
-        if (QRandomGenerator::global()->bounded(2) == 0) {
+        if (core.randomBounded(2) == 0) {
             agent->setEnabled(false);
+            core.setAgentEnabled(agent->getIndex(), false);
         }
     }
 
     for (const auto& agent : redAgents) {
-        if (QRandomGenerator::global()->bounded(2) == 0) {
+        if (core.randomBounded(2) == 0) {
             agent->setEnabled(false);
+            core.setAgentEnabled(agent->getIndex(), false);
         }
     }
 
     // Reset the scores
+    core.resetScores();
     blueScore = 0;
     redScore = 0;
     updateScoreDisplay();
@@ -497,46 +445,19 @@ void GameManager::runTestCase5() {
 }
 
 void GameManager::updateAgentPositions() {
-    for (const auto& agent : blueAgents) {
-        agent->setFlagPosition(redFlagPos);
-        agent->setBasePosition(blueBasePos);
-    }
-
-    for (const auto& agent : redAgents) {
-        agent->setFlagPosition(blueFlagPos);
-        agent->setBasePosition(redBasePos);
-    }
+    core.setFlagPosition(Team::Blue, FieldPoint{ blueFlagPos.x(), blueFlagPos.y() });
+    core.setFlagPosition(Team::Red, FieldPoint{ redFlagPos.x(), redFlagPos.y() });
+    core.setBasePosition(Team::Blue, FieldPoint{ blueBasePos.x(), blueBasePos.y() });
+    core.setBasePosition(Team::Red, FieldPoint{ redBasePos.x(), redBasePos.y() });
 }
 
 bool GameManager::isFlagCaptured(const std::string& side) const {
-    if (side == "blue") {
-        for (const auto& agent : redAgents) {
-            if (agent->getIsCarryingFlag()) {
-                return true;
-            }
-        }
-    }
-    else if (side == "red") {
-        for (const auto& agent : blueAgents) {
-            if (agent->getIsCarryingFlag()) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return core.isFlagCaptured(side == "blue" ? Team::Blue : Team::Red);
 }
 
 void GameManager::resetSimulation() {
     // Clear the existing agents
-    for (const auto& agent : blueAgents) {
-        scene->removeItem(agent.get());
-    }
-    blueAgents.clear();
-
-    for (const auto& agent : redAgents) {
-        scene->removeItem(agent.get());
-    }
-    redAgents.clear();
+    clearAgents();
 
     // Reset the team zones and flags to their default positions
     blueZone->setRect(50, 260, 80, 80);
@@ -546,45 +467,17 @@ void GameManager::resetSimulation() {
     redFlagPos = redZone->rect().center();
     blueBasePos = QPointF(50, 280);
     redBasePos = QPointF(750, 280);
+    updateAgentPositions();
 
-    // Remove the old flags
-    QList<QGraphicsItem*> items = scene->items();
-    for (QGraphicsItem* item : items) {
-        if (item->type() == QGraphicsPolygonItem::Type) {
-            scene->removeItem(item);
-            delete item;
-        }
-        else if (item->type() == QGraphicsTextItem::Type && item != blueScoreTextItem && item != redScoreTextItem && item != timeRemainingTextItem) {
-            scene->removeItem(item);
-            delete item;
-        }
-    }
-
-    // Create new flags
-    QGraphicsPolygonItem* blueFlag = new QGraphicsPolygonItem();
-    QPolygon blueTriangle;
-    qreal blueFlagCenter = blueZone->rect().center().y();
-    blueTriangle << QPoint(blueFlagPos.x() - 10, blueFlagCenter - 20)
-        << QPoint(blueFlagPos.x(), blueFlagCenter)
-        << QPoint(blueFlagPos.x() + 10, blueFlagCenter - 20);
-    blueFlag->setPolygon(blueTriangle);
-    blueFlag->setBrush(Qt::blue);
-    scene->addItem(blueFlag);
-
-    QGraphicsPolygonItem* redFlag = new QGraphicsPolygonItem();
-    QPolygon redTriangle;
-    qreal redFlagCenter = redZone->rect().center().y();
-    redTriangle << QPoint(redFlagPos.x() - 10, redFlagCenter - 20)
-        << QPoint(redFlagPos.x(), redFlagCenter)
-        << QPoint(redFlagPos.x() + 10, redFlagCenter - 20);
-    redFlag->setPolygon(redTriangle);
-    redFlag->setBrush(Qt::red);
-    scene->addItem(redFlag);
+    // Move the flags back onto their stands and remove the "Game Over" text
+    syncFlags();
+    delete winnerTextItem;
 
     // Set up the default agents
     setupAgents();
 
     // Reset the scores
+    core.resetScores();
     blueScore = 0;
     redScore = 0;
     updateScoreDisplay();
@@ -607,21 +500,5 @@ void GameManager::resetScoreAndGameOverText() {
     redScoreTextItem->setPlainText("Red Score: 0");
 
     // Remove the "Game Over" text
-    QList<QGraphicsItem*> items = scene->items();
-    for (QGraphicsItem* item : items) {
-        if (item->type() == QGraphicsTextItem::Type && item != blueScoreTextItem && item != redScoreTextItem && item != timeRemainingTextItem) {
-            scene->removeItem(item);
-            delete item;
-        }
-    }
-}
-
-void GameManager::incrementBlueScore() {
-    blueScore++;
-    updateScoreDisplay();
+    delete winnerTextItem;
 }
-
-void GameManager::incrementRedScore() {
-    redScore++;
-    updateScoreDisplay();
-}
\ No newline at end of file
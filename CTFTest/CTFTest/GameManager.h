@@ -6,13 +6,15 @@
 #include <QTimer>
 #include <QPointer>
 #include "Agent.h"
-#include "GameManager.h"
-#include "Pathfinder.h"
+#include "FlagManager.h"
+#include "SimulationCore.h"
 #include <QList>
 
 class GameManager : public QGraphicsView {
 public:
-    GameManager(QWidget* parent = nullptr);
+    // pathCellSize is the side of a pathfinding cell in pixels. Grid memory and search cost
+    // drop with its square, at the price of coarser paths.
+    GameManager(QWidget* parent = nullptr, int pathCellSize = 1);
 
     void setupScene();
     void setupAgents();
@@ -27,8 +29,6 @@ public:
     bool isFlagCaptured(const std::string& side) const;
     void resetSimulation();
     void resetScoreAndGameOverText();
-    void incrementBlueScore();
-    void incrementRedScore();
     void gameLoop();
     void stopGame();
     void declareWinner();
@@ -38,15 +38,30 @@ public:
     std::vector<std::shared_ptr<Agent>>& getBlueAgents() { return blueAgents; }
     std::vector<std::shared_ptr<Agent>>& getRedAgents() { return redAgents; }
 
+    // The game itself, which the scene only draws
+    SimulationCore& getCore() { return core; }
+    const SimulationCore& getCore() const { return core; }
+
     static int blueScore;
     static int redScore;
 
 private:
+    // Adds an agent to the core and its item to the scene
+    void addAgent(Team team, const QPointF& position);
+    // Point in [0, width) x [0, height) from the core's generator
+    QPointF randomPosition(int width, int height);
+    void clearAgents();
+    // Brings both flag items up to date with the core
+    void syncFlags();
+
     std::vector<std::shared_ptr<Agent>> blueAgents;
     std::vector<std::shared_ptr<Agent>> redAgents;
     QGraphicsScene* scene;
     QGraphicsEllipseItem* blueZone;
     QGraphicsEllipseItem* redZone;
+    FlagManager* blueFlag;
+    FlagManager* redFlag;
+    QPointer<QGraphicsTextItem> winnerTextItem;
     QGraphicsTextItem* timeRemainingTextItem;
     QPointer<QGraphicsTextItem> blueScoreTextItem;
     QPointer<QGraphicsTextItem> redScoreTextItem;
@@ -58,5 +73,5 @@ private:
     int timeRemaining;
     int gameFieldWidth;
     int gameFieldHeight;
-
+    SimulationCore core;
 };
\ No newline at end of file
@@ -0,0 +1,476 @@
+#include "HierarchicalPathfinder.h"
+#include "OccupancyGrid.h"
+#include "Pathfinder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+    const float unreachable = std::numeric_limits<float>::infinity();
+    const int startNode = -1;
+    const int goalNode = -2;
+
+    // Dijkstra scratch for one cluster, stamped like the dense engine's scratch
+    struct ClusterSearchScratch {
+        std::uint32_t generation = 0;
+        std::vector<std::uint32_t> stamp;
+        std::vector<std::uint32_t> targetStamp;
+        std::vector<float> dist;
+        std::vector<std::pair<float, int>> heap;
+
+        void prepare(int cellCount) {
+            if (static_cast<int>(stamp.size()) < cellCount) {
+                stamp.assign(cellCount, 0);
+                targetStamp.assign(cellCount, 0);
+                dist.resize(cellCount);
+                generation = 0;
+            }
+            if (++generation == 0) {
+                std::fill(stamp.begin(), stamp.end(), 0);
+                std::fill(targetStamp.begin(), targetStamp.end(), 0);
+                generation = 1;
+            }
+            heap.clear();
+        }
+    };
+
+    struct AbstractRecord {
+        float gScore;
+        int parent;
+        bool closed;
+    };
+
+    struct AbstractSearchScratch {
+        std::unordered_map<int, AbstractRecord> records;
+        std::vector<std::tuple<float, float, int>> openSet;
+        std::vector<float> startCosts;
+        std::vector<float> goalCosts;
+        std::vector<int> targetCells;
+        std::vector<int> route;
+    };
+
+    thread_local ClusterSearchScratch clusterScratch;
+    thread_local AbstractSearchScratch abstractScratch;
+}
+
+HierarchicalPathfinder::HierarchicalPathfinder(int width, int height, int clusterSize)
+    : width(width), height(height), clusterSize(clusterSize),
+    clusterColumns((width + clusterSize - 1) / clusterSize),
+    clusterRows((height + clusterSize - 1) / clusterSize),
+    refinementHorizon(2), shortQueryDistance(2 * clusterSize), built(false), syncedEpoch(0),
+    lastPathPartial(false), lastExpansionCount(0), lastRebuildCount(0) {
+    clusters.resize(static_cast<std::size_t>(clusterColumns) * clusterRows);
+    for (int cy = 0; cy < clusterRows; ++cy) {
+        for (int cx = 0; cx < clusterColumns; ++cx) {
+            Cluster& cluster = clusters[cy * clusterColumns + cx];
+            cluster.minX = cx * clusterSize;
+            cluster.minY = cy * clusterSize;
+            cluster.maxX = std::min(width, (cx + 1) * clusterSize) - 1;
+            cluster.maxY = std::min(height, (cy + 1) * clusterSize) - 1;
+            cluster.builtEpoch = 0;
+        }
+    }
+}
+
+void HierarchicalPathfinder::sync(const OccupancyGrid& grid) {
+    if (built && grid.getEpoch() == syncedEpoch) {
+        return;
+    }
+
+    lastRebuildCount = 0;
+    std::vector<char> needsCosts(clusters.size(), 0);
+    for (int index = 0; index < static_cast<int>(clusters.size()); ++index) {
+        if (!built || hasChanged(grid, clusters[index])) {
+            needsCosts[index] = 1;
+            for (int side = 0; side < 4; ++side) {
+                rebuildBorder(grid, index, side, needsCosts);
+            }
+        }
+    }
+
+    // A changed border also changes the transitions of the cluster on its other side
+    for (int index = 0; index < static_cast<int>(clusters.size()); ++index) {
+        if (needsCosts[index]) {
+            rebuildCosts(grid, clusters[index]);
+            clusters[index].builtEpoch = grid.getEpoch();
+            ++lastRebuildCount;
+        }
+    }
+
+    built = true;
+    syncedEpoch = grid.getEpoch();
+}
+
+bool HierarchicalPathfinder::hasChanged(const OccupancyGrid& grid, const Cluster& cluster) const {
+    int regionSize = grid.getRegionSize();
+    for (int y = cluster.minY - cluster.minY % regionSize; y <= cluster.maxY; y += regionSize) {
+        for (int x = cluster.minX - cluster.minX % regionSize; x <= cluster.maxX; x += regionSize) {
+            if (grid.getRegionEpoch(x, y) > cluster.builtEpoch) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void HierarchicalPathfinder::rebuildBorder(const OccupancyGrid& grid, int clusterIndex, int side, std::vector<char>& needsCosts) {
+    Cluster& cluster = clusters[clusterIndex];
+    int cx = clusterIndex % clusterColumns;
+    int cy = clusterIndex / clusterColumns;
+    const int neighborX[] = { cx - 1, cx, cx + 1, cx };
+    const int neighborY[] = { cy, cy - 1, cy, cy + 1 };
+
+    std::vector<Transition> transitions;
+    if (neighborX[side] >= 0 && neighborX[side] < clusterColumns && neighborY[side] >= 0 && neighborY[side] < clusterRows) {
+        int neighborIndex = neighborY[side] * clusterColumns + neighborX[side];
+
+        // Walk the border cell by cell; (x, y) is inside this cluster, (x + dx, y + dy) across
+        bool vertical = (side == 0 || side == 2);
+        int length = vertical ? cluster.maxY - cluster.minY + 1 : cluster.maxX - cluster.minX + 1;
+        int dx = (side == 0) ? -1 : (side == 2) ? 1 : 0;
+        int dy = (side == 1) ? -1 : (side == 3) ? 1 : 0;
+        int fixed = (side == 0) ? cluster.minX : (side == 1) ? cluster.minY : (side == 2) ? cluster.maxX : cluster.maxY;
+
+        auto cellAt = [&](int offset, int across) {
+            int x = vertical ? fixed + across * dx : cluster.minX + offset;
+            int y = vertical ? cluster.minY + offset : fixed + across * dy;
+            return grid.toCell(x, y);
+            };
+
+        // One transition in the middle of every run of cells that are free on both sides
+        int runStart = -1;
+        for (int offset = 0; offset <= length; ++offset) {
+            bool open = offset < length &&
+                !grid.isOccupiedCell(cellAt(offset, 0)) && !grid.isOccupiedCell(cellAt(offset, 1));
+            if (open && runStart < 0) {
+                runStart = offset;
+            }
+            else if (!open && runStart >= 0) {
+                int middle = (runStart + offset - 1) / 2;
+                transitions.push_back({ cellAt(middle, 0), cellAt(middle, 1), neighborIndex });
+                runStart = -1;
+            }
+        }
+
+        std::vector<Transition> mirrored;
+        for (const Transition& transition : transitions) {
+            mirrored.push_back({ transition.partnerCell, transition.cell, clusterIndex });
+        }
+
+        std::vector<Transition>& neighborSide = clusters[neighborIndex].sides[(side + 2) % 4];
+        if (neighborSide != mirrored) {
+            neighborSide.swap(mirrored);
+            needsCosts[neighborIndex] = 1;
+        }
+    }
+
+    cluster.sides[side].swap(transitions);
+}
+
+void HierarchicalPathfinder::rebuildCosts(const OccupancyGrid& grid, Cluster& cluster) {
+    cluster.nodes.clear();
+    for (const auto& side : cluster.sides) {
+        cluster.nodes.insert(cluster.nodes.end(), side.begin(), side.end());
+    }
+
+    std::vector<int> targetCells;
+    for (const Transition& node : cluster.nodes) {
+        targetCells.push_back(node.cell);
+    }
+
+    std::size_t count = cluster.nodes.size();
+    cluster.costs.assign(count * count, unreachable);
+
+    // Without occupied cells or overlay costs every step costs the same, so the in-cluster
+    // cost between two transitions is just their Manhattan distance
+    bool uniform = true;
+    for (int y = cluster.minY; y <= cluster.maxY && uniform; ++y) {
+        for (int x = cluster.minX; x <= cluster.maxX; ++x) {
+            int cell = grid.toCell(x, y);
+            if (grid.isOccupiedCell(cell) || grid.getOverlayCost(cell) != 0.0f) {
+                uniform = false;
+                break;
+            }
+        }
+    }
+
+    if (uniform) {
+        for (std::size_t from = 0; from < count; ++from) {
+            for (std::size_t to = 0; to < count; ++to) {
+                int fromCell = cluster.nodes[from].cell;
+                int toCell = cluster.nodes[to].cell;
+                int distance = std::abs(fromCell % width - toCell % width) + std::abs(fromCell / width - toCell / width);
+                cluster.costs[from * count + to] = static_cast<float>(distance * Pathfinder::getStepCost(grid, toCell));
+            }
+        }
+        return;
+    }
+
+    std::vector<float> rowCosts;
+    for (std::size_t from = 0; from < count; ++from) {
+        lastExpansionCount += searchCluster(grid, cluster, cluster.nodes[from].cell, false, targetCells, rowCosts);
+        std::copy(rowCosts.begin(), rowCosts.end(), cluster.costs.begin() + from * count);
+    }
+}
+
+std::size_t HierarchicalPathfinder::searchCluster(const OccupancyGrid& grid, const Cluster& cluster, int sourceCell, bool reverse,
+    const std::vector<int>& targetCells, std::vector<float>& targetCosts, int goalCell) const {
+    ClusterSearchScratch& scratch = clusterScratch;
+    const int localWidth = cluster.maxX - cluster.minX + 1;
+    const int localHeight = cluster.maxY - cluster.minY + 1;
+    scratch.prepare(localWidth * localHeight);
+
+    auto toLocal = [&](int cell) {
+        return (cell / width - cluster.minY) * localWidth + (cell % width - cluster.minX);
+        };
+    auto comparator = [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+        return a.first > b.first;
+        };
+
+    int remaining = 0;
+    for (int cell : targetCells) {
+        int local = toLocal(cell);
+        if (scratch.targetStamp[local] != scratch.generation) {
+            scratch.targetStamp[local] = scratch.generation;
+            ++remaining;
+        }
+    }
+
+    int sourceLocal = toLocal(sourceCell);
+    scratch.stamp[sourceLocal] = scratch.generation;
+    scratch.dist[sourceLocal] = 0.0f;
+    scratch.heap.emplace_back(0.0f, sourceLocal);
+
+    const int dx[] = { -1, 0, 1, 0 };
+    const int dy[] = { 0, -1, 0, 1 };
+    std::size_t expansions = 0;
+    while (!scratch.heap.empty() && remaining > 0) {
+        std::pop_heap(scratch.heap.begin(), scratch.heap.end(), comparator);
+        auto [distance, local] = scratch.heap.back();
+        scratch.heap.pop_back();
+        if (distance > scratch.dist[local]) {
+            continue;
+        }
+
+        ++expansions;
+        if (scratch.targetStamp[local] == scratch.generation) {
+            --remaining;
+        }
+
+        int x = cluster.minX + local % localWidth;
+        int y = cluster.minY + local / localWidth;
+        int cell = grid.toCell(x, y);
+        for (int i = 0; i < 4; ++i) {
+            int newX = x + dx[i];
+            int newY = y + dy[i];
+            if (newX < cluster.minX || newX > cluster.maxX || newY < cluster.minY || newY > cluster.maxY) {
+                continue;
+            }
+
+            int neighborCell = grid.toCell(newX, newY);
+            if (neighborCell != goalCell && grid.isOccupiedCell(neighborCell)) {
+                continue;
+            }
+
+            // Backwards searches pay for the cell being stepped onto on the way to the source
+            float step = static_cast<float>(Pathfinder::getStepCost(grid, reverse ? cell : neighborCell));
+            int neighborLocal = toLocal(neighborCell);
+            float tentative = distance + step;
+            if (scratch.stamp[neighborLocal] != scratch.generation || tentative < scratch.dist[neighborLocal]) {
+                scratch.stamp[neighborLocal] = scratch.generation;
+                scratch.dist[neighborLocal] = tentative;
+                scratch.heap.emplace_back(tentative, neighborLocal);
+                std::push_heap(scratch.heap.begin(), scratch.heap.end(), comparator);
+            }
+        }
+    }
+
+    targetCosts.resize(targetCells.size());
+    for (std::size_t i = 0; i < targetCells.size(); ++i) {
+        int local = toLocal(targetCells[i]);
+        targetCosts[i] = (scratch.stamp[local] == scratch.generation) ? scratch.dist[local] : unreachable;
+    }
+    return expansions;
+}
+
+std::vector<std::pair<int, int>> HierarchicalPathfinder::findPath(int startX, int startY, int goalX, int goalY,
+    const OccupancyGrid& grid, Pathfinder& refiner) {
+    sync(grid);
+    return findPath(startX, startY, goalX, goalY, grid, refiner, lastPathPartial, lastExpansionCount);
+}
+
+std::vector<std::pair<int, int>> HierarchicalPathfinder::findPath(int startX, int startY, int goalX, int goalY,
+    const OccupancyGrid& grid, Pathfinder& refiner, bool& partial, std::size_t& expansions) const {
+    expansions = 0;
+    partial = false;
+
+    AbstractSearchScratch& scratch = abstractScratch;
+    const int stride = 4 * clusterSize + 4;
+    const int startCell = grid.toCell(startX, startY);
+    const int goalCell = grid.toCell(goalX, goalY);
+    const int startCluster = clusterOf(startX, startY);
+    const int goalCluster = clusterOf(goalX, goalY);
+    const Cluster& startClusterRef = clusters[startCluster];
+    const Cluster& goalClusterRef = clusters[goalCluster];
+
+    // Connect the start and goal to the transitions of their clusters
+    scratch.targetCells.clear();
+    for (const Transition& node : startClusterRef.nodes) {
+        scratch.targetCells.push_back(node.cell);
+    }
+    if (startCluster == goalCluster) {
+        scratch.targetCells.push_back(goalCell);
+    }
+    expansions += searchCluster(grid, startClusterRef, startCell, false, scratch.targetCells, scratch.startCosts, goalCell);
+
+    scratch.targetCells.clear();
+    for (const Transition& node : goalClusterRef.nodes) {
+        scratch.targetCells.push_back(node.cell);
+    }
+    expansions += searchCluster(grid, goalClusterRef, goalCell, true, scratch.targetCells, scratch.goalCosts);
+
+    auto cellOf = [&](int id) {
+        if (id == startNode) {
+            return startCell;
+        }
+        if (id == goalNode) {
+            return goalCell;
+        }
+        return clusters[id / stride].nodes[id % stride].cell;
+        };
+    auto heuristic = [&](int cell) {
+        return static_cast<float>(std::abs(cell % width - goalX) + std::abs(cell / width - goalY));
+        };
+    auto comparator = [](const std::tuple<float, float, int>& a, const std::tuple<float, float, int>& b) {
+        return std::get<0>(a) > std::get<0>(b);
+        };
+
+    scratch.records.clear();
+    scratch.openSet.clear();
+    scratch.records[startNode] = { 0.0f, startNode, false };
+    scratch.openSet.emplace_back(heuristic(startCell), 0.0f, startNode);
+
+    bool found = false;
+    while (!scratch.openSet.empty()) {
+        std::pop_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+        auto [_, currentGScore, current] = scratch.openSet.back();
+        scratch.openSet.pop_back();
+
+        AbstractRecord& record = scratch.records[current];
+        if (record.closed || currentGScore > record.gScore) {
+            continue;
+        }
+        record.closed = true;
+        ++expansions;
+
+        if (current == goalNode) {
+            found = true;
+            break;
+        }
+
+        auto relax = [&](int next, float cost) {
+            if (cost == unreachable) {
+                return;
+            }
+            float tentative = currentGScore + cost;
+            auto inserted = scratch.records.try_emplace(next, AbstractRecord{ tentative, current, false });
+            AbstractRecord& nextRecord = inserted.first->second;
+            if (inserted.second || (!nextRecord.closed && tentative < nextRecord.gScore)) {
+                nextRecord.gScore = tentative;
+                nextRecord.parent = current;
+                scratch.openSet.emplace_back(tentative + heuristic(cellOf(next)), tentative, next);
+                std::push_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+            }
+            };
+
+        if (current == startNode) {
+            for (std::size_t j = 0; j < startClusterRef.nodes.size(); ++j) {
+                relax(startCluster * stride + static_cast<int>(j), scratch.startCosts[j]);
+            }
+            if (startCluster == goalCluster) {
+                relax(goalNode, scratch.startCosts.back());
+            }
+            continue;
+        }
+
+        int clusterIndex = current / stride;
+        int nodeIndex = current % stride;
+        const Cluster& cluster = clusters[clusterIndex];
+        std::size_t count = cluster.nodes.size();
+        for (std::size_t j = 0; j < count; ++j) {
+            if (static_cast<int>(j) != nodeIndex) {
+                relax(clusterIndex * stride + static_cast<int>(j), cluster.costs[nodeIndex * count + j]);
+            }
+        }
+
+        const Transition& transition = cluster.nodes[nodeIndex];
+        const Cluster& partner = clusters[transition.partnerCluster];
+        for (std::size_t j = 0; j < partner.nodes.size(); ++j) {
+            if (partner.nodes[j].cell == transition.partnerCell && partner.nodes[j].partnerCell == transition.cell) {
+                relax(transition.partnerCluster * stride + static_cast<int>(j),
+                    static_cast<float>(Pathfinder::getStepCost(grid, transition.partnerCell)));
+                break;
+            }
+        }
+
+        if (clusterIndex == goalCluster) {
+            relax(goalNode, scratch.goalCosts[nodeIndex]);
+        }
+    }
+
+    if (!found) {
+        return std::vector<std::pair<int, int>>();
+    }
+
+    scratch.route.clear();
+    for (int id = goalNode; id != startNode; id = scratch.records[id].parent) {
+        scratch.route.push_back(cellOf(id));
+    }
+    scratch.route.push_back(startCell);
+    std::reverse(scratch.route.begin(), scratch.route.end());
+
+    // Refine abstract edges into cell steps, stopping after the refinement horizon
+    std::vector<std::pair<int, int>> path;
+    path.push_back({ startX, startY });
+    int refinedEdges = 0;
+    for (std::size_t i = 0; i + 1 < scratch.route.size(); ++i) {
+        int fromCell = scratch.route[i];
+        int toCell = scratch.route[i + 1];
+        int fromX = fromCell % width;
+        int fromY = fromCell / width;
+        int toX = toCell % width;
+        int toY = toCell / width;
+        if (fromCell == toCell) {
+            continue;
+        }
+        if (std::abs(toX - fromX) + std::abs(toY - fromY) == 1) {
+            path.push_back({ toX, toY });
+            continue;
+        }
+
+        if (refinementHorizon > 0 && refinedEdges == refinementHorizon) {
+            partial = true;
+            break;
+        }
+
+        const Cluster& cluster = clusters[clusterOf(fromX, fromY)];
+        SearchBounds bounds{ cluster.minX, cluster.minY, cluster.maxX, cluster.maxY };
+        std::vector<std::pair<int, int>> segment = refiner.findPath(fromX, fromY, toX, toY, grid, bounds);
+        expansions += refiner.getLastExpansionCount();
+        if (segment.empty()) {
+            // The cached costs said this edge exists; fall back to a flat search rather than fail
+            std::vector<std::pair<int, int>> flatPath = refiner.findPath(startX, startY, goalX, goalY, grid,
+                SearchBounds{ 0, 0, width - 1, height - 1 });
+            expansions += refiner.getLastExpansionCount();
+            partial = false;
+            return flatPath;
+        }
+
+        path.insert(path.end(), segment.begin() + 1, segment.end());
+        ++refinedEdges;
+    }
+
+    return path;
+}
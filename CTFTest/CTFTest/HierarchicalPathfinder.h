@@ -0,0 +1,90 @@
+#ifndef HIERARCHICALPATHFINDER_H
+#define HIERARCHICALPATHFINDER_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+class OccupancyGrid;
+class Pathfinder;
+
+// HPA* over the occupancy grid. The field is split into square clusters, neighbouring clusters
+// are linked by one transition per free stretch of their shared border, and the in-cluster
+// cost between every pair of transitions is cached. A long query searches this small abstract
+// graph and then refines only the first few abstract edges into cell steps; the rest of the
+// route is left for the next query once the agent reaches the end of the refined part.
+class HierarchicalPathfinder {
+public:
+    HierarchicalPathfinder(int width, int height, int clusterSize = 20);
+
+    // Rebuilds the clusters whose grid regions changed since the previous sync. Called lazily
+    // by findPath, so it costs nothing on ticks without hierarchical queries.
+    void sync(const OccupancyGrid& grid);
+
+    std::vector<std::pair<int, int>> findPath(int startX, int startY, int goalX, int goalY,
+        const OccupancyGrid& grid, Pathfinder& refiner);
+
+    // Same query without syncing or touching the hierarchy's own state, so several threads can
+    // run it at once after a sync with the grid. The results go to partial and expansions.
+    std::vector<std::pair<int, int>> findPath(int startX, int startY, int goalX, int goalY,
+        const OccupancyGrid& grid, Pathfinder& refiner, bool& partial, std::size_t& expansions) const;
+
+    // Abstract edges refined into cell steps per query, 0 refines the whole route
+    void setRefinementHorizon(int edges) { refinementHorizon = edges; }
+    int getRefinementHorizon() const { return refinementHorizon; }
+
+    // Queries at or below this Manhattan distance are cheaper as a flat search
+    void setShortQueryDistance(int distance) { shortQueryDistance = distance; }
+    int getShortQueryDistance() const { return shortQueryDistance; }
+
+    bool isLastPathPartial() const { return lastPathPartial; }
+    std::size_t getLastExpansionCount() const { return lastExpansionCount; }
+    std::size_t getLastRebuildCount() const { return lastRebuildCount; }
+
+private:
+    struct Transition {
+        int cell;           // cell inside this cluster
+        int partnerCell;    // neighbouring cell across the border
+        int partnerCluster;
+
+        bool operator==(const Transition& other) const {
+            return cell == other.cell && partnerCell == other.partnerCell && partnerCluster == other.partnerCluster;
+        }
+    };
+
+    struct Cluster {
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+        std::vector<Transition> sides[4]; // left, top, right, bottom
+        std::vector<Transition> nodes;    // all sides concatenated
+        std::vector<float> costs;         // nodes x nodes in-cluster costs, row is the source
+        std::uint32_t builtEpoch;
+    };
+
+    int clusterOf(int x, int y) const { return (y / clusterSize) * clusterColumns + (x / clusterSize); }
+    bool hasChanged(const OccupancyGrid& grid, const Cluster& cluster) const;
+    void rebuildBorder(const OccupancyGrid& grid, int clusterIndex, int side, std::vector<char>& needsCosts);
+    void rebuildCosts(const OccupancyGrid& grid, Cluster& cluster);
+    // Returns the number of cells expanded
+    std::size_t searchCluster(const OccupancyGrid& grid, const Cluster& cluster, int sourceCell, bool reverse,
+        const std::vector<int>& targetCells, std::vector<float>& targetCosts, int goalCell = -1) const;
+
+    int width;
+    int height;
+    int clusterSize;
+    int clusterColumns;
+    int clusterRows;
+    int refinementHorizon;
+    int shortQueryDistance;
+    bool built;
+    std::uint32_t syncedEpoch;
+    bool lastPathPartial;
+    std::size_t lastExpansionCount;
+    std::size_t lastRebuildCount;
+    std::vector<Cluster> clusters;
+};
+
+#endif
@@ -0,0 +1,336 @@
+#include "IncrementalPlanner.h"
+#include "OccupancyGrid.h"
+#include "Pathfinder.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+    const double unreachable = std::numeric_limits<double>::infinity();
+    const int dx[] = { -1, 0, 1, 0 };
+    const int dy[] = { 0, -1, 0, 1 };
+
+    // Keys of overconsistent cells scale the heuristic by slightly more than 1, as in Anytime
+    // D*. That breaks the ties of the open field toward the agent, so the search follows one
+    // route instead of flooding every equal-cost one. Underconsistent cells keep the plain
+    // heuristic so their increases still reach the agent. The factor keeps any path within
+    // one step of the shortest, so with whole step costs the path found is a shortest one.
+    const double tieBreak = 1.0 + 1.0 / 2048.0;
+
+    // Heap order: smallest key first, compared lexicographically
+    bool keyGreater(const std::tuple<double, double, int>& a, const std::tuple<double, double, int>& b) {
+        if (std::get<0>(a) != std::get<0>(b)) {
+            return std::get<0>(a) > std::get<0>(b);
+        }
+        return std::get<1>(a) > std::get<1>(b);
+    }
+}
+
+IncrementalPlanner::IncrementalPlanner(int width, int height, std::size_t maxExpansions)
+    : width(width), height(height), maxExpansions(maxExpansions), maxGoalShift(8), grid(nullptr),
+    initialized(false), startCell(0), goalCell(0), km(0.0), epoch(0), appliedChanges(0), lastExpansionCount(0), nodeCount(0) {}
+
+std::vector<std::pair<int, int>> IncrementalPlanner::findPath(int startX, int startY, int goalX, int goalY,
+    const OccupancyGrid& grid) {
+    lastExpansionCount = 0;
+    if (!grid.isValidPosition(startX, startY) || !grid.isValidPosition(goalX, goalY)) {
+        return std::vector<std::pair<int, int>>();
+    }
+
+    int newStart = grid.toCell(startX, startY);
+    int newGoal = grid.toCell(goalX, goalY);
+    const std::vector<int>& changedCells = grid.getChangedCells();
+    bool missedChanges = grid.getEpoch() != epoch && grid.getEpoch() != epoch + 1;
+    int goalShift = std::abs(newGoal % width - goalCell % width) + std::abs(newGoal / width - goalCell / width);
+
+    // The changes of a skipped epoch are gone, and a far jump of the target rebuilds most of
+    // the tree anyway, so both start over
+    if (!initialized || this->grid != &grid || missedChanges || goalShift > maxGoalShift) {
+        this->grid = &grid;
+        restart(newStart, newGoal);
+    }
+    else {
+        if (newStart != startCell) {
+            km += tieBreak * heuristic(startCell, newStart);
+            startCell = newStart;
+        }
+
+        // A changed cell changes the cost of entering it, which only its neighbours see
+        std::size_t firstChange = grid.getEpoch() == epoch ? appliedChanges : 0;
+        for (std::size_t i = firstChange; i < changedCells.size(); ++i) {
+            updateNeighbors(changedCells[i]);
+        }
+
+        if (newGoal != goalCell) {
+            int oldGoal = goalCell;
+            goalCell = newGoal;
+            updateVertex(oldGoal);
+            updateVertex(newGoal);
+            updateNeighbors(oldGoal);
+            updateNeighbors(newGoal);
+        }
+    }
+    epoch = grid.getEpoch();
+    appliedChanges = changedCells.size();
+
+    if (!computeShortestPath() || getG(startCell) == unreachable) {
+        // Over the expansion limit or unreachable, the tree is not worth keeping
+        initialized = false;
+        return std::vector<std::pair<int, int>>();
+    }
+
+    // Walk down the cost-to-goal values from the agent
+    std::vector<std::pair<int, int>> path;
+    path.push_back({ startX, startY });
+    int cell = startCell;
+    while (cell != goalCell && path.size() <= nodeCount) {
+        int x = cell % width;
+        int y = cell / width;
+        int bestCell = -1;
+        double best = unreachable;
+        for (int d = 0; d < 4; ++d) {
+            int newX = x + dx[d];
+            int newY = y + dy[d];
+            if (!grid.isValidPosition(newX, newY)) {
+                continue;
+            }
+
+            int neighborCell = newY * width + newX;
+            if (!isEnterable(neighborCell)) {
+                continue;
+            }
+
+            double cost = Pathfinder::getStepCost(grid, neighborCell) + getG(neighborCell);
+            if (cost < best) {
+                best = cost;
+                bestCell = neighborCell;
+            }
+        }
+
+        if (bestCell == -1) {
+            initialized = false;
+            return std::vector<std::pair<int, int>>();
+        }
+        cell = bestCell;
+        path.push_back({ cell % width, cell / width });
+    }
+    return path;
+}
+
+void IncrementalPlanner::restart(int newStart, int newGoal) {
+    std::fill(slotCells.begin(), slotCells.end(), -1);
+    nodeCount = 0;
+    openSet.clear();
+    km = 0.0;
+    startCell = newStart;
+    goalCell = newGoal;
+    initialized = true;
+
+    Node& goal = insertNode(goalCell);
+    goal.rhs = 0.0;
+    push(goalCell, goal);
+}
+
+const IncrementalPlanner::Node* IncrementalPlanner::findNode(int cell) const {
+    if (nodeCount == 0) {
+        return nullptr;
+    }
+
+    std::size_t mask = slotCells.size() - 1;
+    for (std::size_t slot = (static_cast<std::uint32_t>(cell) * 2654435761u) & mask;; slot = (slot + 1) & mask) {
+        if (slotCells[slot] == cell) {
+            return &slotNodes[slot];
+        }
+        if (slotCells[slot] == -1) {
+            return nullptr;
+        }
+    }
+}
+
+IncrementalPlanner::Node* IncrementalPlanner::findNode(int cell) {
+    return const_cast<Node*>(static_cast<const IncrementalPlanner*>(this)->findNode(cell));
+}
+
+IncrementalPlanner::Node& IncrementalPlanner::insertNode(int cell) {
+    // Open addressing with linear probing, kept at most half full
+    if ((nodeCount + 1) * 2 > slotCells.size()) {
+        std::vector<int> oldCells = std::move(slotCells);
+        std::vector<Node> oldNodes = std::move(slotNodes);
+        std::size_t capacity = std::max<std::size_t>(1024, oldCells.size() * 2);
+        slotCells.assign(capacity, -1);
+        slotNodes.resize(capacity);
+        nodeCount = 0;
+        for (std::size_t i = 0; i < oldCells.size(); ++i) {
+            if (oldCells[i] != -1) {
+                insertNode(oldCells[i]) = oldNodes[i];
+            }
+        }
+    }
+
+    std::size_t mask = slotCells.size() - 1;
+    std::size_t slot = (static_cast<std::uint32_t>(cell) * 2654435761u) & mask;
+    while (slotCells[slot] != -1) {
+        slot = (slot + 1) & mask;
+    }
+    slotCells[slot] = cell;
+    slotNodes[slot] = Node{ unreachable, unreachable, 0.0, 0.0, false };
+    ++nodeCount;
+    return slotNodes[slot];
+}
+
+bool IncrementalPlanner::isEnterable(int cell) const {
+    return cell == goalCell || !grid->isOccupiedCell(cell);
+}
+
+double IncrementalPlanner::heuristic(int fromCell, int toCell) const {
+    return std::abs(fromCell % width - toCell % width) + std::abs(fromCell / width - toCell / width);
+}
+
+std::pair<double, double> IncrementalPlanner::calculateKey(int cell, const Node& node) const {
+    if (node.g > node.rhs) {
+        return { node.rhs + tieBreak * heuristic(startCell, cell) + km, node.rhs };
+    }
+    return { node.g + heuristic(startCell, cell) + km, node.g };
+}
+
+double IncrementalPlanner::getG(int cell) const {
+    const Node* node = findNode(cell);
+    return node != nullptr ? node->g : unreachable;
+}
+
+double IncrementalPlanner::computeRhs(int cell) const {
+    if (cell == goalCell) {
+        return 0.0;
+    }
+
+    int x = cell % width;
+    int y = cell / width;
+    double best = unreachable;
+    for (int d = 0; d < 4; ++d) {
+        int newX = x + dx[d];
+        int newY = y + dy[d];
+        if (!grid->isValidPosition(newX, newY)) {
+            continue;
+        }
+
+        int neighborCell = newY * width + newX;
+        double g = getG(neighborCell);
+        if (g != unreachable && isEnterable(neighborCell)) {
+            best = std::min(best, g + Pathfinder::getStepCost(*grid, neighborCell));
+        }
+    }
+    return best;
+}
+
+void IncrementalPlanner::updateVertex(int cell) {
+    double rhs = computeRhs(cell);
+    Node* found = findNode(cell);
+    if (found == nullptr && rhs == unreachable) {
+        return; // never reached and still unreachable, nothing to remember
+    }
+
+    Node& node = found != nullptr ? *found : insertNode(cell);
+    node.rhs = rhs;
+    if (node.g != node.rhs) {
+        push(cell, node);
+    }
+    else {
+        node.open = false;
+    }
+}
+
+void IncrementalPlanner::updateNeighbors(int cell) {
+    int x = cell % width;
+    int y = cell / width;
+    for (int d = 0; d < 4; ++d) {
+        int newX = x + dx[d];
+        int newY = y + dy[d];
+        if (grid->isValidPosition(newX, newY)) {
+            updateVertex(newY * width + newX);
+        }
+    }
+}
+
+void IncrementalPlanner::push(int cell, Node& node) {
+    // The heap is lazy: an entry only counts while it matches the key stored on the node
+    std::pair<double, double> key = calculateKey(cell, node);
+    if (node.open && node.k1 == key.first && node.k2 == key.second) {
+        return; // already queued with this key
+    }
+
+    std::tie(node.k1, node.k2) = key;
+    node.open = true;
+    openSet.emplace_back(node.k1, node.k2, cell);
+    std::push_heap(openSet.begin(), openSet.end(), keyGreater);
+
+    if (openSet.size() > 4 * nodeCount + 1024) {
+        // Superseded entries pile up over many ticks, keep only the live ones
+        openSet.clear();
+        for (std::size_t slot = 0; slot < slotCells.size(); ++slot) {
+            if (slotCells[slot] != -1 && slotNodes[slot].open) {
+                openSet.emplace_back(slotNodes[slot].k1, slotNodes[slot].k2, slotCells[slot]);
+            }
+        }
+        std::make_heap(openSet.begin(), openSet.end(), keyGreater);
+    }
+}
+
+bool IncrementalPlanner::computeShortestPath() {
+    auto popTop = [&]() {
+        std::pop_heap(openSet.begin(), openSet.end(), keyGreater);
+        openSet.pop_back();
+        };
+
+    for (;;) {
+        // Skip entries that were superseded by a later push or closed since
+        while (!openSet.empty()) {
+            auto [k1, k2, cell] = openSet.front();
+            const Node* node = findNode(cell);
+            if (node != nullptr && node->open && node->k1 == k1 && node->k2 == k2) {
+                break;
+            }
+            popTop();
+        }
+        if (openSet.empty()) {
+            return true;
+        }
+
+        // Done once nothing queued sorts before the agent's cell and that cell is consistent
+        const Node* startNode = findNode(startCell);
+        Node start = startNode != nullptr ? *startNode : Node{ unreachable, unreachable, 0.0, 0.0, false };
+        std::pair<double, double> startKey = calculateKey(startCell, start);
+        auto [k1, k2, cell] = openSet.front();
+        if (std::make_pair(k1, k2) >= startKey && start.rhs == start.g) {
+            return true;
+        }
+        if (lastExpansionCount >= maxExpansions) {
+            return false;
+        }
+        ++lastExpansionCount;
+
+        // Neighbour updates may grow the table, so the reference is not used after them
+        Node& node = *findNode(cell);
+        if (std::make_pair(k1, k2) < calculateKey(cell, node)) {
+            // The key went stale as the agent moved, queue it again with the current one
+            popTop();
+            push(cell, node);
+        }
+        else if (node.g > node.rhs) {
+            node.g = node.rhs;
+            node.open = false;
+            popTop();
+            if (isEnterable(cell)) {
+                updateNeighbors(cell);
+            }
+        }
+        else {
+            node.g = unreachable;
+            node.open = false;
+            popTop();
+            updateVertex(cell);
+            if (isEnterable(cell)) {
+                updateNeighbors(cell);
+            }
+        }
+    }
+}
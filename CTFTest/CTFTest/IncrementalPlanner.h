@@ -0,0 +1,77 @@
+#ifndef INCREMENTALPLANNER_H
+#define INCREMENTALPLANNER_H
+
+#include <vector>
+#include <utility>
+#include <tuple>
+#include <cstdint>
+#include <cstddef>
+
+class OccupancyGrid;
+
+// D* Lite for an agent that replans every tick toward a target that moves too. The search
+// runs backwards from the target, so the agent moving along its path only shifts the key
+// modifier, cells that changed in the grid only update their neighbours, and a target that
+// stepped to a nearby cell is handled by updating the old and the new goal cell. Everything
+// else in the search tree is reused. Node state lives in a small hash table, since each agent
+// owns one planner and only touches a small part of the field.
+class IncrementalPlanner {
+public:
+    IncrementalPlanner(int width, int height, std::size_t maxExpansions = 100000);
+
+    // Same contract as Pathfinder's grid search: cells from start to goal inclusive, the goal
+    // is passable even when occupied, empty when no path was found within the expansion limit
+    std::vector<std::pair<int, int>> findPath(int startX, int startY, int goalX, int goalY,
+        const OccupancyGrid& grid);
+
+    // Drops the search tree, the next query starts from scratch
+    void reset() { initialized = false; }
+
+    // A target that jumps further than this is searched for from scratch instead
+    void setMaxGoalShift(int cells) { maxGoalShift = cells; }
+
+    std::size_t getLastExpansionCount() const { return lastExpansionCount; }
+    std::size_t getNodeCount() const { return nodeCount; }
+
+private:
+    struct Node {
+        double g;
+        double rhs;
+        double k1;
+        double k2;
+        bool open;
+    };
+
+    const Node* findNode(int cell) const;
+    Node* findNode(int cell);
+    Node& insertNode(int cell);
+    void restart(int startCell, int goalCell);
+    bool isEnterable(int cell) const;
+    double heuristic(int fromCell, int toCell) const;
+    std::pair<double, double> calculateKey(int cell, const Node& node) const;
+    double getG(int cell) const;
+    double computeRhs(int cell) const;
+    void updateVertex(int cell);
+    void updateNeighbors(int cell);
+    void push(int cell, Node& node);
+    bool computeShortestPath();
+
+    int width;
+    int height;
+    std::size_t maxExpansions;
+    int maxGoalShift;
+    const OccupancyGrid* grid;
+    bool initialized;
+    int startCell;
+    int goalCell;
+    double km;
+    std::uint32_t epoch;
+    std::size_t appliedChanges;
+    std::size_t lastExpansionCount;
+    std::vector<int> slotCells;     // hash table of touched cells, -1 marks a free slot
+    std::vector<Node> slotNodes;
+    std::size_t nodeCount;
+    std::vector<std::tuple<double, double, int>> openSet;
+};
+
+#endif
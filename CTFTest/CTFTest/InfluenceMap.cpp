@@ -0,0 +1,148 @@
+#include "InfluenceMap.h"
+#include "SimdSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(SIMD_HAS_AVX2) || defined(SIMD_HAS_SSE2)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Each level returns how far it got, the scalar loop does the rest. No level fuses the
+    // multiply and the add, so all of them produce the same map.
+#if defined(SIMD_HAS_AVX2)
+    SIMD_TARGET_AVX2 int multiplyAddAvx2(float* out, const float* in, float weight, int count) {
+        int i = 0;
+        __m256 factor = _mm256_set1_ps(weight);
+        for (; i + 8 <= count; i += 8) {
+            __m256 sum = _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(factor, _mm256_loadu_ps(in + i)));
+            _mm256_storeu_ps(out + i, sum);
+        }
+        return i;
+    }
+#endif
+
+#if defined(SIMD_HAS_SSE2)
+    int multiplyAddSse2(float* out, const float* in, float weight, int count) {
+        int i = 0;
+        __m128 factor = _mm_set1_ps(weight);
+        for (; i + 4 <= count; i += 4) {
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(factor, _mm_loadu_ps(in + i)));
+            _mm_storeu_ps(out + i, sum);
+        }
+        return i;
+    }
+#endif
+
+    // out[i] += weight * in[i], the one kernel both blur passes are made of
+    void multiplyAdd(float* out, const float* in, float weight, int count) {
+        int i = 0;
+#if defined(SIMD_HAS_AVX2) || defined(SIMD_HAS_SSE2)
+        SimdLevel level = getSimdLevel();
+#endif
+#if defined(SIMD_HAS_AVX2)
+        if (level == SimdLevel::Avx2) {
+            i = multiplyAddAvx2(out, in, weight, count);
+        }
+#endif
+#if defined(SIMD_HAS_SSE2)
+        if (level == SimdLevel::Sse2) {
+            i = multiplyAddSse2(out, in, weight, count);
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] += weight * in[i];
+        }
+    }
+}
+
+InfluenceMap::InfluenceMap(int width, int height, int sampleSize, float sigma)
+    : width(width), height(height), sampleSize(sampleSize),
+    columns((width + sampleSize - 1) / sampleSize), rows((height + sampleSize - 1) / sampleSize),
+    radius(static_cast<int>(std::ceil(3.0f * sigma))),
+    values(static_cast<std::size_t>(columns) * rows, 0.0f),
+    blurredRows(static_cast<std::size_t>(columns) * rows, 0.0f),
+    paddedRow(static_cast<std::size_t>(columns) + 2 * radius, 0.0f),
+    rowSpans(rows, { 0, -1 }), lastBuildMicroseconds(0) {
+    for (int offset = -radius; offset <= radius; ++offset) {
+        weights.push_back(std::exp(-0.5f * offset * offset / (sigma * sigma)));
+    }
+}
+
+void InfluenceMap::build(const std::vector<std::pair<int, int>>& sourceCells) {
+    auto buildStart = std::chrono::steady_clock::now();
+    std::fill(values.begin(), values.end(), 0.0f);
+    std::fill(blurredRows.begin(), blurredRows.end(), 0.0f);
+    std::fill(rowSpans.begin(), rowSpans.end(), std::make_pair(0, -1));
+
+    // Sources grouped by sample row
+    std::vector<std::pair<int, int>> sourceSamples;
+    for (const auto& cell : sourceCells) {
+        if (cell.first >= 0 && cell.first < width && cell.second >= 0 && cell.second < height) {
+            sourceSamples.push_back({ cell.second / sampleSize, cell.first / sampleSize });
+        }
+    }
+    std::sort(sourceSamples.begin(), sourceSamples.end());
+
+    // Horizontal pass, only on the rows holding a source. They are splatted into a padded row
+    // first so the pass needs no edge checks.
+    for (std::size_t i = 0; i < sourceSamples.size();) {
+        int row = sourceSamples[i].first;
+        std::fill(paddedRow.begin(), paddedRow.end(), 0.0f);
+        for (; i < sourceSamples.size() && sourceSamples[i].first == row; ++i) {
+            paddedRow[sourceSamples[i].second + radius] += 1.0f;
+        }
+
+        float* out = &blurredRows[static_cast<std::size_t>(row) * columns];
+        for (int tap = 0; tap <= 2 * radius; ++tap) {
+            multiplyAdd(out, &paddedRow[tap], weights[tap], columns);
+        }
+    }
+
+    // Vertical pass: each blurred source row is spread over the rows within the radius
+    for (std::size_t i = 0; i < sourceSamples.size();) {
+        int sourceRow = sourceSamples[i].first;
+        int first = sourceSamples[i].second;
+        int last = first;
+        for (; i < sourceSamples.size() && sourceSamples[i].first == sourceRow; ++i) {
+            last = sourceSamples[i].second;
+        }
+
+        const float* in = &blurredRows[static_cast<std::size_t>(sourceRow) * columns];
+        int spanFirst = std::max(first - radius, 0);
+        int spanLast = std::min(last + radius, columns - 1);
+        for (int row = std::max(sourceRow - radius, 0); row <= std::min(sourceRow + radius, rows - 1); ++row) {
+            multiplyAdd(&values[static_cast<std::size_t>(row) * columns], in, weights[row - sourceRow + radius], columns);
+
+            std::pair<int, int>& span = rowSpans[row];
+            if (span.second < span.first) {
+                span = { spanFirst, spanLast };
+            }
+            else {
+                span = { std::min(span.first, spanFirst), std::max(span.second, spanLast) };
+            }
+        }
+    }
+
+    lastBuildMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - buildStart).count();
+}
+
+int InfluenceMap::findThreatColumn(int x, int y, int step) const {
+    // Each row keeps the hull of its nonzero samples, which is conservative between sources
+    const std::pair<int, int>& span = rowSpans[y / sampleSize];
+    if (span.second < span.first) {
+        return -1;
+    }
+
+    int first = span.first * sampleSize;
+    int last = std::min(span.second * sampleSize + sampleSize - 1, width - 1);
+    if (x >= first && x <= last) {
+        return x;
+    }
+    if (step > 0) {
+        return x < first ? first : -1;
+    }
+    return x > last ? last : -1;
+}
@@ -0,0 +1,45 @@
+#ifndef INFLUENCEMAP_H
+#define INFLUENCEMAP_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Threat a set of agents spreads over the field, rebuilt once per tick from their cells.
+// Every agent adds a Gaussian bump of height 1 that is cut off at three sigma, so cells
+// far from all of them read exactly 0. The map is kept on coarse samples of sampleSize
+// path cells and blurred with two separable passes, and reading a cell costs O(1).
+class InfluenceMap {
+public:
+    // width and height in path cells, sigma in samples
+    InfluenceMap(int width, int height, int sampleSize, float sigma);
+
+    void build(const std::vector<std::pair<int, int>>& sourceCells);
+
+    float sample(int x, int y) const {
+        return values[(y / sampleSize) * columns + x / sampleSize];
+    }
+
+    // First column from x in the step direction (+1 or -1) of row y that may carry threat,
+    // or -1 if there is none. May stop early, never late.
+    int findThreatColumn(int x, int y, int step) const;
+
+    int getSampleSize() const { return sampleSize; }
+    std::int64_t getLastBuildMicroseconds() const { return lastBuildMicroseconds; }
+
+private:
+    int width;
+    int height;
+    int sampleSize;
+    int columns;
+    int rows;
+    int radius;
+    std::vector<float> weights;    // kernel taps from -radius to radius
+    std::vector<float> values;
+    std::vector<float> blurredRows; // horizontal pass, the vertical one reads it
+    std::vector<float> paddedRow;
+    std::vector<std::pair<int, int>> rowSpans; // first and last nonzero sample of each row
+    std::int64_t lastBuildMicroseconds;
+};
+
+#endif
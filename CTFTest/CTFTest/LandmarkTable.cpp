@@ -0,0 +1,113 @@
+#include "LandmarkTable.h"
+#include "OccupancyGrid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <tuple>
+
+LandmarkTable::LandmarkTable(int width, int height, PathConnectivity connectivity)
+    : width(width), height(height), connectivity(connectivity), dirty(true), builtOverlayVersion(0),
+    landmarkCount(0), roundingSlack(0.0f), buildCount(0), lastBuildMicroseconds(0) {}
+
+void LandmarkTable::setLandmarks(const std::vector<std::pair<int, int>>& cells) {
+    std::vector<std::pair<int, int>> inside;
+    for (const auto& cell : cells) {
+        if (cell.first >= 0 && cell.first < width && cell.second >= 0 && cell.second < height &&
+            std::find(inside.begin(), inside.end(), cell) == inside.end()) {
+            inside.push_back(cell);
+        }
+    }
+    if (inside != landmarks) {
+        landmarks = inside;
+        dirty = true;
+    }
+}
+
+void LandmarkTable::sync(const OccupancyGrid& grid) {
+    if (dirty || grid.getOverlayVersion() != builtOverlayVersion) {
+        build(grid);
+    }
+}
+
+void LandmarkTable::build(const OccupancyGrid& grid) {
+    auto buildStart = std::chrono::steady_clock::now();
+    dirty = false;
+    builtOverlayVersion = grid.getOverlayVersion();
+    ++buildCount;
+
+    if (!grid.hasOverlay() || landmarks.empty()) {
+        landmarkCount = 0;
+        distances.clear();
+        distances.shrink_to_fit();
+        lastBuildMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - buildStart).count();
+        return;
+    }
+
+    const int dx[] = { -1, 0, 1, 0, -1, 1, -1, 1 };
+    const int dy[] = { 0, -1, 0, 1, -1, -1, 1, 1 };
+    const int moveCount = connectivity == PathConnectivity::Eight ? 8 : 4;
+    const double diagonalLength = std::sqrt(2.0);
+
+    const std::size_t cellCount = static_cast<std::size_t>(width) * height;
+    landmarkCount = static_cast<int>(landmarks.size());
+    distances.assign(cellCount * landmarkCount, 0.0f);
+
+    // Dijkstra from each landmark. Nothing is blocked statically, so every move is open and
+    // every cell is reached.
+    std::vector<double> distance(cellCount);
+    std::vector<std::pair<double, int>> openSet;
+    auto comparator = std::greater<std::pair<double, int>>();
+    double maxDistance = 0.0;
+    for (int landmark = 0; landmark < landmarkCount; ++landmark) {
+        std::fill(distance.begin(), distance.end(), std::numeric_limits<double>::infinity());
+        int source = grid.toCell(landmarks[landmark].first, landmarks[landmark].second);
+        distance[source] = 0.0;
+        openSet.clear();
+        openSet.emplace_back(0.0, source);
+
+        while (!openSet.empty()) {
+            std::pop_heap(openSet.begin(), openSet.end(), comparator);
+            auto [cellDistance, cell] = openSet.back();
+            openSet.pop_back();
+            if (cellDistance > distance[cell]) {
+                continue;
+            }
+
+            int x = cell % width;
+            int y = cell / width;
+            for (int i = 0; i < moveCount; ++i) {
+                int newX = x + dx[i];
+                int newY = y + dy[i];
+                if (newX < 0 || newX >= width || newY < 0 || newY >= height) {
+                    continue;
+                }
+
+                int neighborCell = newY * width + newX;
+                double stepCost = Pathfinder::getStaticStepCost(grid, neighborCell);
+                if (i >= 4) {
+                    stepCost *= diagonalLength;
+                }
+                if (cellDistance + stepCost < distance[neighborCell]) {
+                    distance[neighborCell] = cellDistance + stepCost;
+                    openSet.emplace_back(distance[neighborCell], neighborCell);
+                    std::push_heap(openSet.begin(), openSet.end(), comparator);
+                }
+            }
+        }
+
+        for (std::size_t cell = 0; cell < cellCount; ++cell) {
+            distances[cell * landmarkCount + landmark] = static_cast<float>(distance[cell]);
+            maxDistance = std::max(maxDistance, distance[cell]);
+        }
+    }
+
+    // Storing both distances and subtracting them in float each round by at most half an
+    // ulp of the largest distance
+    roundingSlack = static_cast<float>(maxDistance * std::ldexp(1.0, -22));
+
+    lastBuildMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - buildStart).count();
+}
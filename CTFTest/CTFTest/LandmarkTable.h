@@ -0,0 +1,72 @@
+#ifndef LANDMARKTABLE_H
+#define LANDMARKTABLE_H
+
+#include "Pathfinder.h"
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+class OccupancyGrid;
+
+// Exact distances from a few landmark cells, such as the field corners, flags and bases, to
+// every cell, for the ALT heuristic. They are measured over the static step costs only, the
+// base cost plus the grid's overlay, which never exceed what a search pays, so the bound
+// d(landmark, goal) - d(landmark, cell) never overestimates. Building costs one Dijkstra
+// search per landmark over the whole grid, so the tables are only rebuilt when the
+// landmarks move or the overlay changes. Without any overlay the static distances are the
+// Manhattan and octile distances themselves, so no tables are kept and searches fall back
+// to those.
+class LandmarkTable {
+public:
+    // Tables built eight-connected also bound four-connected searches, not the other way round
+    LandmarkTable(int width, int height, PathConnectivity connectivity);
+
+    // Takes effect on the next sync; cells outside the grid are dropped
+    void setLandmarks(const std::vector<std::pair<int, int>>& cells);
+
+    // Rebuilds the tables if the landmarks or the grid's overlay changed since the last build
+    void sync(const OccupancyGrid& grid);
+
+    // True when the tables hold anything better than the plain heuristic for that connectivity
+    bool isUsableFor(PathConnectivity searchConnectivity) const {
+        return landmarkCount > 0 && (connectivity == PathConnectivity::Eight || searchConnectivity == PathConnectivity::Four);
+    }
+
+    // Distances from every landmark to the cell, landmarkCount floats in a row
+    const float* getDistances(int cell) const {
+        return &distances[static_cast<std::size_t>(cell) * landmarkCount];
+    }
+
+    // Lower bound on the cost from the cell to the goal whose distances are given
+    double getLowerBound(const float* goalDistances, int cell) const {
+        const float* cellDistances = getDistances(cell);
+        float bound = 0.0f;
+        for (int i = 0; i < landmarkCount; ++i) {
+            bound = std::max(bound, goalDistances[i] - cellDistances[i]);
+        }
+        // Covers rounding the distances to float
+        return bound - roundingSlack;
+    }
+
+    int getLandmarkCount() const { return landmarkCount; }
+    int getBuildCount() const { return buildCount; }
+    std::int64_t getLastBuildMicroseconds() const { return lastBuildMicroseconds; }
+
+private:
+    void build(const OccupancyGrid& grid);
+
+    int width;
+    int height;
+    PathConnectivity connectivity;
+    std::vector<std::pair<int, int>> landmarks;
+    bool dirty;
+    std::uint32_t builtOverlayVersion;
+    int landmarkCount; // landmarks with a table, 0 while the grid has no overlay
+    std::vector<float> distances; // per cell, the distance from each landmark in turn
+    float roundingSlack;
+    int buildCount;
+    std::int64_t lastBuildMicroseconds;
+};
+
+#endif
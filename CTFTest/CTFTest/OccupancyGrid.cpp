@@ -0,0 +1,123 @@
+#include "OccupancyGrid.h"
+#include <algorithm>
+
+namespace {
+    const std::uint8_t OccupiedBit = 1;
+    const std::uint8_t PendingBit = 2;
+}
+
+OccupancyGrid::OccupancyGrid(int width, int height, int regionSize)
+    : width(width), height(height), regionSize(regionSize),
+    regionColumns((width + regionSize - 1) / regionSize), overlayCount(0), epoch(0), overlayVersion(0),
+    cells(static_cast<std::size_t>(width) * height, 0),
+    costOverlay(static_cast<std::size_t>(width) * height, 0.0f),
+    rowWords((width + 63) / 64), rowMarks(static_cast<std::size_t>(rowWords) * height, 0), rowMarkCounts(height, 0),
+    regionEpochs(static_cast<std::size_t>(regionColumns) * ((height + regionSize - 1) / regionSize), 0),
+    cellEpochs(static_cast<std::size_t>(width) * height, 0) {}
+
+void OccupancyGrid::setAgentPositions(const std::vector<std::pair<int, int>>& positions) {
+    ++epoch;
+    changedCells.clear();
+
+    // Flag the new cells first so that cells occupied in both ticks are left alone
+    std::vector<int>& newCells = nextOccupiedCells;
+    newCells.clear();
+    for (const auto& position : positions) {
+        if (isValidPosition(position.first, position.second)) {
+            int cell = toCell(position.first, position.second);
+            if (!(cells[cell] & PendingBit)) {
+                cells[cell] |= PendingBit;
+                newCells.push_back(cell);
+            }
+        }
+    }
+
+    for (int cell : occupiedCells) {
+        if (!(cells[cell] & PendingBit)) {
+            cells[cell] &= ~OccupiedBit;
+            markChanged(cell);
+        }
+    }
+
+    for (int cell : newCells) {
+        bool wasOccupied = cells[cell] & OccupiedBit;
+        cells[cell] = OccupiedBit;
+        if (!wasOccupied) {
+            markChanged(cell);
+        }
+    }
+
+    occupiedCells.swap(nextOccupiedCells);
+}
+
+void OccupancyGrid::setOverlayCost(int x, int y, float cost) {
+    if (!isValidPosition(x, y)) {
+        return;
+    }
+
+    int cell = toCell(x, y);
+    if (costOverlay[cell] == cost) {
+        return;
+    }
+
+    if (costOverlay[cell] == 0.0f) {
+        ++overlayCount;
+    }
+    else if (cost == 0.0f) {
+        --overlayCount;
+    }
+    costOverlay[cell] = cost;
+    markChanged(cell);
+    ++overlayVersion;
+}
+
+void OccupancyGrid::clearOverlay() {
+    if (overlayCount == 0) {
+        return;
+    }
+
+    for (int cell = 0; cell < static_cast<int>(costOverlay.size()); ++cell) {
+        if (costOverlay[cell] != 0.0f) {
+            costOverlay[cell] = 0.0f;
+            markChanged(cell);
+        }
+    }
+    overlayCount = 0;
+    ++overlayVersion;
+}
+
+int OccupancyGrid::findMarkedColumn(int x, int y, int step) const {
+    const std::uint64_t* row = &rowMarks[static_cast<std::size_t>(y) * rowWords];
+    if (rowMarkCounts[y] == 0) {
+        return -1;
+    }
+
+    // Whole empty words are skipped, the set word is then walked bit by bit
+    for (; x >= 0 && x < width; x += step) {
+        std::uint64_t word = row[x >> 6];
+        if (word == 0) {
+            x = step > 0 ? (x | 63) : (x & ~63);
+            continue;
+        }
+        if ((word >> (x & 63)) & 1u) {
+            return x;
+        }
+    }
+    return -1;
+}
+
+void OccupancyGrid::markChanged(int cell) {
+    changedCells.push_back(cell);
+    int x = cell % width;
+    int y = cell / width;
+    regionEpochs[(y / regionSize) * regionColumns + (x / regionSize)] = epoch;
+    cellEpochs[cell] = epoch;
+
+    std::uint64_t& word = rowMarks[static_cast<std::size_t>(y) * rowWords + (x >> 6)];
+    std::uint64_t bit = std::uint64_t(1) << (x & 63);
+    bool marked = (cells[cell] & OccupiedBit) || costOverlay[cell] != 0.0f;
+    if (marked != ((word & bit) != 0)) {
+        word ^= bit;
+        rowMarkCounts[y] += marked ? 1 : -1;
+    }
+}
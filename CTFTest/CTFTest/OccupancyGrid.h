@@ -0,0 +1,76 @@
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Per-tick obstacle map shared by every path query. GameManager rebuilds it once per tick
+// from the agent positions, so a search checks a cell in O(1) instead of scanning the
+// position lists. A separate cost overlay carries soft penalties that never block a cell.
+class OccupancyGrid {
+public:
+    OccupancyGrid(int width, int height, int regionSize = 40);
+
+    // Replaces the occupied cells with the given positions and starts a new epoch.
+    // Only the cells that actually toggled are touched.
+    void setAgentPositions(const std::vector<std::pair<int, int>>& positions);
+
+    void setOverlayCost(int x, int y, float cost);
+    void clearOverlay();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getRegionSize() const { return regionSize; }
+
+    bool isValidPosition(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height;
+    }
+    int toCell(int x, int y) const { return y * width + x; }
+
+    bool isOccupied(int x, int y) const { return cells[toCell(x, y)] != 0; }
+    bool isOccupiedCell(int cell) const { return cells[cell] != 0; }
+    float getOverlayCost(int cell) const { return overlayCount > 0 ? costOverlay[cell] : 0.0f; }
+    bool hasOverlay() const { return overlayCount > 0; }
+
+    // A cell is marked while it is occupied or carries an overlay cost. Returns the first
+    // marked column of row y at or beyond x in the step direction (+1 or -1), or -1 if none.
+    int findMarkedColumn(int x, int y, int step) const;
+
+    // The epoch advances on every setAgentPositions call. Cells that changed during the
+    // current epoch (occupancy or overlay) are listed by getChangedCells, and every region and
+    // cell remembers the epoch it last changed in so cached results can be validated cheaply.
+    std::uint32_t getEpoch() const { return epoch; }
+    const std::vector<int>& getChangedCells() const { return changedCells; }
+    std::uint32_t getRegionEpoch(int x, int y) const {
+        return regionEpochs[(y / regionSize) * regionColumns + (x / regionSize)];
+    }
+    std::uint32_t getCellEpoch(int cell) const { return cellEpochs[cell]; }
+
+    // Advances whenever an overlay cost changes, so anything derived from the overlay alone
+    // can tell it is stale without following the occupancy epochs
+    std::uint32_t getOverlayVersion() const { return overlayVersion; }
+
+private:
+    void markChanged(int cell);
+
+    int width;
+    int height;
+    int regionSize;
+    int regionColumns;
+    int overlayCount;
+    std::uint32_t epoch;
+    std::uint32_t overlayVersion;
+    std::vector<std::uint8_t> cells;
+    std::vector<float> costOverlay;
+    int rowWords;
+    std::vector<std::uint64_t> rowMarks;
+    std::vector<int> rowMarkCounts;
+    std::vector<int> occupiedCells;
+    std::vector<int> nextOccupiedCells;
+    std::vector<int> changedCells;
+    std::vector<std::uint32_t> regionEpochs;
+    std::vector<std::uint32_t> cellEpochs;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "PathCache.h"
+#include "OccupancyGrid.h"
+#include "Pathfinder.h"
+#include <algorithm>
+#include <cstdlib>
+
+PathCache::PathCache(std::size_t maxBytes, int startCellSize)
+    : maxBytes(maxBytes), startCellSize(startCellSize), bytes(0), hits(0), misses(0), evictions(0) {}
+
+std::uint64_t PathCache::makeKey(const OccupancyGrid& grid, PathConnectivity connectivity, int startX, int startY,
+    int goalX, int goalY) const {
+    // The coarse start above the connectivity bit above the goal cell
+    int startColumns = (grid.getWidth() + startCellSize - 1) / startCellSize;
+    std::uint64_t coarseStart = static_cast<std::uint64_t>((startY / startCellSize) * startColumns + startX / startCellSize);
+    std::uint64_t eightConnected = connectivity == PathConnectivity::Eight ? 1 : 0;
+    return (coarseStart << 33) | (eightConnected << 32) | static_cast<std::uint32_t>(grid.toCell(goalX, goalY));
+}
+
+bool PathCache::lookup(const OccupancyGrid& grid, PathConnectivity connectivity, int startX, int startY, int goalX,
+    int goalY, std::vector<std::pair<int, int>>& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!grid.isValidPosition(startX, startY) || !grid.isValidPosition(goalX, goalY)) {
+        ++misses;
+        return false;
+    }
+
+    auto found = index.find(makeKey(grid, connectivity, startX, startY, goalX, goalY));
+    if (found == index.end()) {
+        ++misses;
+        return false;
+    }
+
+    auto it = found->second;
+    if (!isStillValid(grid, *it)) {
+        erase(it);
+        ++misses;
+        return false;
+    }
+    if (!joinStart(grid, startX, startY, *it, path)) {
+        ++misses;
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, it);
+    ++hits;
+    return true;
+}
+
+void PathCache::store(const OccupancyGrid& grid, PathConnectivity connectivity, const std::vector<std::pair<int, int>>& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path.size() < 2) {
+        return;
+    }
+
+    std::uint64_t key = makeKey(grid, connectivity, path.front().first, path.front().second, path.back().first,
+        path.back().second);
+    auto found = index.find(key);
+    if (found != index.end()) {
+        erase(found->second);
+    }
+
+    entries.push_front(Entry{ key, grid.getEpoch(), path });
+    index[key] = entries.begin();
+    bytes += entryBytes(entries.front());
+
+    while (bytes > maxBytes && !entries.empty()) {
+        erase(std::prev(entries.end()));
+        ++evictions;
+    }
+}
+
+void PathCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+std::size_t PathCache::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+std::size_t PathCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+std::size_t PathCache::getEvictions() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return evictions;
+}
+
+std::size_t PathCache::getEntryCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::size_t PathCache::getBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+bool PathCache::isStillValid(const OccupancyGrid& grid, const Entry& entry) const {
+    // The start belonged to whoever stored the path and the goal is always passable, so only
+    // the cells in between matter, plus the two cells every diagonal step brushes past. A cell
+    // that changed in the storing epoch may have changed after the search, so it counts as
+    // changed too.
+    auto hasChanged = [&](int x, int y) {
+        return grid.getCellEpoch(grid.toCell(x, y)) >= entry.epoch;
+        };
+    for (std::size_t i = 1; i < entry.path.size(); ++i) {
+        const std::pair<int, int>& from = entry.path[i - 1];
+        const std::pair<int, int>& to = entry.path[i];
+        if (i + 1 < entry.path.size() && hasChanged(to.first, to.second)) {
+            return false;
+        }
+        if (from.first != to.first && from.second != to.second &&
+            (hasChanged(to.first, from.second) || hasChanged(from.first, to.second))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PathCache::joinStart(const OccupancyGrid& grid, int startX, int startY, const Entry& entry,
+    std::vector<std::pair<int, int>>& path) const {
+    // Join at the closest of the first few path cells, preferring the furthest along on ties
+    // so the agent does not walk back to where the other agent started
+    std::size_t searchEnd = std::min(entry.path.size(), static_cast<std::size_t>(2 * startCellSize + 1));
+    std::size_t joinIndex = 0;
+    int joinDistance = -1;
+    for (std::size_t i = 0; i < searchEnd; ++i) {
+        int distance = std::abs(entry.path[i].first - startX) + std::abs(entry.path[i].second - startY);
+        if (joinDistance == -1 || distance <= joinDistance) {
+            joinIndex = i;
+            joinDistance = distance;
+        }
+    }
+
+    const std::pair<int, int>& join = entry.path[joinIndex];
+    int goalCell = grid.toCell(entry.path.back().first, entry.path.back().second);
+    auto isFree = [&](int x, int y) {
+        int cell = grid.toCell(x, y);
+        return cell == goalCell || !grid.isOccupiedCell(cell);
+        };
+
+    // Straight steps to the join cell, horizontal leg first and then the other way round
+    for (int horizontalFirst = 1; horizontalFirst >= 0; --horizontalFirst) {
+        path.clear();
+        path.push_back({ startX, startY });
+        int x = startX;
+        int y = startY;
+        bool blocked = false;
+        while (!blocked && (x != join.first || y != join.second)) {
+            bool moveHorizontal = horizontalFirst ? x != join.first : y == join.second;
+            if (moveHorizontal) {
+                x += join.first > x ? 1 : -1;
+            }
+            else {
+                y += join.second > y ? 1 : -1;
+            }
+            blocked = !isFree(x, y);
+            path.push_back({ x, y });
+        }
+
+        if (!blocked) {
+            path.insert(path.end(), entry.path.begin() + joinIndex + 1, entry.path.end());
+            return true;
+        }
+    }
+
+    path.clear();
+    return false;
+}
+
+std::size_t PathCache::entryBytes(const Entry& entry) {
+    // The entry and its cells, plus roughly a list node and an index node
+    return sizeof(Entry) + entry.path.capacity() * sizeof(std::pair<int, int>) + 4 * sizeof(void*) + sizeof(std::uint64_t);
+}
+
+void PathCache::erase(std::list<Entry>::iterator it) {
+    bytes -= entryBytes(*it);
+    index.erase(it->key);
+    entries.erase(it);
+}
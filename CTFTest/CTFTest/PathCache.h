@@ -0,0 +1,69 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <vector>
+#include <utility>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+class OccupancyGrid;
+enum class PathConnectivity;
+
+// Complete paths shared between agents, keyed by the coarse cell around the start, the exact
+// goal cell and the moves the search could make, so a four-connected search is never handed
+// diagonal steps. An entry remembers the grid epoch it was found in and is reused as long
+// as none of its cells changed since; the caller's exact start is joined onto it with a few
+// straight steps. Least recently used entries are evicted to stay under the byte cap.
+// Lookups and stores lock the cache, so pathfinders on several threads can share it.
+class PathCache {
+public:
+    PathCache(std::size_t maxBytes = 4 * 1024 * 1024, int startCellSize = 8);
+
+    // Fills path and returns true on a hit
+    bool lookup(const OccupancyGrid& grid, PathConnectivity connectivity, int startX, int startY, int goalX, int goalY,
+        std::vector<std::pair<int, int>>& path);
+
+    // Remembers a complete path a search with the given moves found during the grid's
+    // current epoch
+    void store(const OccupancyGrid& grid, PathConnectivity connectivity, const std::vector<std::pair<int, int>>& path);
+
+    void clear();
+
+    // The counters lock the cache too, so they can be read while other threads search
+    std::size_t getHits() const;
+    std::size_t getMisses() const;
+    std::size_t getEvictions() const;
+    std::size_t getEntryCount() const;
+    std::size_t getBytes() const;
+    std::size_t getMaxBytes() const { return maxBytes; }
+
+private:
+    struct Entry {
+        std::uint64_t key;
+        std::uint32_t epoch;
+        std::vector<std::pair<int, int>> path;
+    };
+
+    std::uint64_t makeKey(const OccupancyGrid& grid, PathConnectivity connectivity, int startX, int startY, int goalX,
+        int goalY) const;
+    bool isStillValid(const OccupancyGrid& grid, const Entry& entry) const;
+    bool joinStart(const OccupancyGrid& grid, int startX, int startY, const Entry& entry,
+        std::vector<std::pair<int, int>>& path) const;
+    static std::size_t entryBytes(const Entry& entry);
+    void erase(std::list<Entry>::iterator it);
+
+    std::size_t maxBytes;
+    int startCellSize;
+    std::size_t bytes;
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t evictions;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+    mutable std::mutex mutex;
+};
+
+#endif
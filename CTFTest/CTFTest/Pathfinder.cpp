@@ -1,4 +1,10 @@
 #include "Pathfinder.h"
+#include "OccupancyGrid.h"
+#include "HierarchicalPathfinder.h"
+#include "PathCache.h"
+#include "ThreadPool.h"
+#include "InfluenceMap.h"
+#include "LandmarkTable.h"
 #include <queue>
 #include <cmath>
 #include <algorithm>
@@ -6,11 +12,395 @@
 #include <unordered_set>
 #include <vector>
 #include <functional>
+#include <cstdint>
+#include <tuple>
+#include <chrono>
+#include <limits>
+#include <memory_resource>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+namespace {
+    // Heap behind the search scratch of a thread. It counts every allocation that reaches it,
+    // which stops once the scratch has grown to fit the largest search the thread ran.
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        std::size_t allocationCount = 0;
+        std::size_t allocatedBytes = 0;
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++allocationCount;
+            allocatedBytes += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    thread_local CountingResource searchMemory;
+
+    // Scratch state for the dense engine. It is sized to the field once and then reused by
+    // every search on the thread; a cell's gScore/cameFrom entries are only valid when its
+    // stamp equals the current generation, so nothing has to be cleared between searches.
+    struct DenseSearchScratch {
+        int width = 0;
+        int height = 0;
+        std::uint32_t generation = 0;
+        std::pmr::vector<std::uint32_t> stamp{ &searchMemory };
+        std::pmr::vector<double> gScore{ &searchMemory };
+        std::pmr::vector<int> cameFrom{ &searchMemory };
+        std::pmr::vector<std::int8_t> arrivalDirection{ &searchMemory }; // jump point search only
+        std::pmr::vector<std::uint64_t> closedSet{ &searchMemory };
+        std::pmr::vector<std::tuple<double, double, int>> openSet{ &searchMemory };
+        std::pmr::vector<int> touched{ &searchMemory };      // budgeted searches only, cells given a score
+        std::pmr::vector<int> traceUp{ &searchMemory };      // traceTree only
+        std::pmr::vector<int> traceDown{ &searchMemory };
+
+        // The goal side of a bidirectional search, allocated the first time one runs
+        std::pmr::vector<std::uint32_t> reverseStamp{ &searchMemory };
+        std::pmr::vector<double> reverseGScore{ &searchMemory };
+        std::pmr::vector<int> reverseNext{ &searchMemory };
+        std::pmr::vector<std::uint64_t> reverseClosedSet{ &searchMemory };
+        std::pmr::vector<std::tuple<double, double, int>> reverseOpenSet{ &searchMemory };
+
+        void prepare(int fieldWidth, int fieldHeight) {
+            if (width != fieldWidth || height != fieldHeight) {
+                width = fieldWidth;
+                height = fieldHeight;
+                std::size_t cellCount = static_cast<std::size_t>(width) * height;
+                stamp.assign(cellCount, 0);
+                gScore.resize(cellCount);
+                cameFrom.resize(cellCount);
+                arrivalDirection.resize(cellCount);
+                closedSet.assign((cellCount + 63) / 64, 0);
+                reverseStamp.clear();
+                generation = 0;
+            }
+
+            if (++generation == 0) {
+                // The stamp counter wrapped, so old stamps could alias the new generation
+                std::fill(stamp.begin(), stamp.end(), 0);
+                std::fill(reverseStamp.begin(), reverseStamp.end(), 0);
+                generation = 1;
+            }
+
+            // 480k cells is only 7.5k words, clearing the bitset is cheaper than tracking it
+            std::fill(closedSet.begin(), closedSet.end(), 0);
+            openSet.clear();
+            touched.clear();
+        }
+
+        bool isClosed(int cell) const {
+            return (closedSet[cell >> 6] >> (cell & 63)) & 1u;
+        }
+
+        void close(int cell) {
+            closedSet[cell >> 6] |= std::uint64_t(1) << (cell & 63);
+        }
+
+        bool hasScore(int cell) const {
+            return stamp[cell] == generation;
+        }
+
+        void setScore(int cell, double score, int parent) {
+            stamp[cell] = generation;
+            gScore[cell] = score;
+            cameFrom[cell] = parent;
+        }
+
+        // Call after prepare, it shares the generation
+        void prepareReverse() {
+            std::size_t cellCount = stamp.size();
+            if (reverseStamp.size() != cellCount) {
+                reverseStamp.assign(cellCount, 0);
+                reverseGScore.resize(cellCount);
+                reverseNext.resize(cellCount);
+                reverseClosedSet.resize(closedSet.size());
+            }
+            std::fill(reverseClosedSet.begin(), reverseClosedSet.end(), 0);
+            reverseOpenSet.clear();
+        }
+
+        bool isReverseClosed(int cell) const {
+            return (reverseClosedSet[cell >> 6] >> (cell & 63)) & 1u;
+        }
+
+        void closeReverse(int cell) {
+            reverseClosedSet[cell >> 6] |= std::uint64_t(1) << (cell & 63);
+        }
+
+        bool hasReverseScore(int cell) const {
+            return reverseStamp[cell] == generation;
+        }
+
+        void setReverseScore(int cell, double score, int next) {
+            reverseStamp[cell] = generation;
+            reverseGScore[cell] = score;
+            reverseNext[cell] = next;
+        }
+    };
+
+    thread_local DenseSearchScratch denseScratch;
+
+    // Byte buffer the hash map engine builds its containers in. A search carves them out of
+    // it with a monotonic resource and drops them all at once; whatever it had to take from
+    // the heap beyond the buffer is added to the buffer, so the next search fits in it.
+    thread_local std::pmr::vector<std::byte> hashSearchBuffer{ &searchMemory };
+
+    // Cells from startCell to endCell along cameFrom, in a path allocated once with room for
+    // extraCells more
+    std::vector<std::pair<int, int>> traceParents(const DenseSearchScratch& scratch, int width, int startCell,
+        int endCell, std::size_t extraCells = 0) {
+        std::size_t length = 1;
+        for (int cell = endCell; cell != startCell; cell = scratch.cameFrom[cell]) {
+            ++length;
+        }
+
+        std::vector<std::pair<int, int>> path;
+        path.reserve(length + extraCells);
+        path.resize(length);
+        int cell = endCell;
+        for (std::size_t i = length; i-- > 0; cell = scratch.cameFrom[cell]) {
+            path[i] = { cell % width, cell / width };
+        }
+        return path;
+    }
+
+    // Cells from fromCell to targetCell along the search tree rooted at rootCell. When fromCell
+    // is not an ancestor of targetCell, the path first walks back up to the branch they share.
+    std::vector<std::pair<int, int>> traceTree(DenseSearchScratch& scratch, int width, int fromCell,
+        int targetCell, int rootCell) {
+        // Both chains end at the root, and their common tail is the shared branch
+        std::pmr::vector<int>& up = scratch.traceUp;
+        std::pmr::vector<int>& down = scratch.traceDown;
+        up.clear();
+        down.clear();
+        for (int cell = fromCell;; cell = scratch.cameFrom[cell]) {
+            up.push_back(cell);
+            if (cell == rootCell) {
+                break;
+            }
+        }
+        for (int cell = targetCell;; cell = scratch.cameFrom[cell]) {
+            down.push_back(cell);
+            if (cell == rootCell) {
+                break;
+            }
+        }
+
+        int joint = rootCell;
+        while (!up.empty() && !down.empty() && up.back() == down.back()) {
+            joint = up.back();
+            up.pop_back();
+            down.pop_back();
+        }
+
+        std::vector<std::pair<int, int>> path;
+        path.reserve(up.size() + 1 + down.size());
+        for (int cell : up) {
+            path.push_back({ cell % width, cell / width });
+        }
+        path.push_back({ joint % width, joint / width });
+        for (auto it = down.rbegin(); it != down.rend(); ++it) {
+            path.push_back({ *it % width, *it / width });
+        }
+        return path;
+    }
+
+    const double baseCost = 1.0;
+    const double enemyCost = 10.0;
+    const double agentCost = 5.0;
+
+    // Obstacle test and step cost read from the raw position lists (linear scans)
+    struct PositionListObstacles {
+        const std::vector<std::pair<int, int>>& enemyPositions;
+        const std::vector<std::pair<int, int>>& agentPositions;
+
+        bool contains(const std::vector<std::pair<int, int>>& positions, int x, int y) const {
+            return std::find(positions.begin(), positions.end(), std::make_pair(x, y)) != positions.end();
+        }
+
+        bool isPassable(int x, int y, int) const {
+            return !contains(enemyPositions, x, y) && !contains(agentPositions, x, y);
+        }
+
+        double getCost(int, int, int) const {
+            // Occupied cells are never passable here, so only the base cost applies
+            return baseCost;
+        }
+
+        bool isUniform(int, int, int) const {
+            return true;
+        }
+
+        int findStopColumn(int x, int y, int step) const {
+            int nearest = -1;
+            for (const auto* positions : { &enemyPositions, &agentPositions }) {
+                for (const auto& position : *positions) {
+                    if (std::abs(position.second - y) <= 1 && (position.first - x) * step >= 0 &&
+                        (nearest == -1 || (position.first - nearest) * step < 0)) {
+                        nearest = position.first;
+                    }
+                }
+            }
+            return nearest;
+        }
+    };
+
+    // Obstacle test and step cost read from the shared per-tick grid in O(1). The goal cell
+    // stays passable even when occupied, since the occupant is usually what is being chased.
+    // With an influence map the threat it reads, times its weight, is added to every step.
+    struct GridObstacles {
+        const OccupancyGrid& grid;
+        int goalCell;
+        SearchBounds bounds;
+        const InfluenceMap* influence;
+        double influenceWeight;
+
+        bool isPassable(int x, int y, int cell) const {
+            if (x < bounds.minX || x > bounds.maxX || y < bounds.minY || y > bounds.maxY) {
+                return false;
+            }
+            return cell == goalCell || !grid.isOccupiedCell(cell);
+        }
+
+        double getCost(int x, int y, int cell) const {
+            double cost = Pathfinder::getStepCost(grid, cell);
+            if (influence != nullptr) {
+                cost += influenceWeight * influence->sample(x, y);
+            }
+            return cost;
+        }
+
+        // True when stepping onto the cell costs exactly the base cost
+        bool isUniform(int x, int y, int cell) const {
+            return !grid.isOccupiedCell(cell) && grid.getOverlayCost(cell) == 0.0f &&
+                (influence == nullptr || influence->sample(x, y) == 0.0f);
+        }
+
+        // First column from x in the step direction holding an occupied, soft-cost or
+        // threatened cell in rows y-1..y+1, or -1 if there is none
+        int findStopColumn(int x, int y, int step) const {
+            int nearest = -1;
+            for (int row = std::max(y - 1, 0); row <= std::min(y + 1, grid.getHeight() - 1); ++row) {
+                int column = grid.findMarkedColumn(x, row, step);
+                if (column != -1 && (nearest == -1 || (column - nearest) * step < 0)) {
+                    nearest = column;
+                }
+                column = influence != nullptr ? influence->findThreatColumn(x, row, step) : -1;
+                if (column != -1 && (nearest == -1 || (column - nearest) * step < 0)) {
+                    nearest = column;
+                }
+            }
+            return nearest;
+        }
+    };
+
+    // Neighbourhoods of the dense search. The orthogonal moves come first, in the order every
+    // other search uses, so four-connected results are unchanged.
+    struct FourConnected {
+        static constexpr int moveCount = 4;
+        static constexpr int dx[moveCount] = { -1, 0, 1, 0 };
+        static constexpr int dy[moveCount] = { 0, -1, 0, 1 };
+    };
+
+    struct EightConnected {
+        static constexpr int moveCount = 8;
+        static constexpr int dx[moveCount] = { -1, 0, 1, 0, -1, 1, -1, 1 };
+        static constexpr int dy[moveCount] = { 0, -1, 0, 1, -1, -1, 1, 1 };
+    };
+
+    constexpr double diagonalLength = 1.4142135623730951;
+
+    // Heuristics of the dense search, estimating the cost from a cell to the goal
+    struct ManhattanDistance {
+        int goalX;
+        int goalY;
+
+        double estimate(int x, int y, int) const {
+            return std::abs(x - goalX) + std::abs(y - goalY);
+        }
+    };
+
+    struct OctileDistance {
+        int goalX;
+        int goalY;
+
+        double estimate(int x, int y, int) const {
+            int dx = std::abs(x - goalX);
+            int dy = std::abs(y - goalY);
+            return std::max(dx, dy) + (diagonalLength - 1.0) * std::min(dx, dy);
+        }
+    };
+
+    struct EuclideanDistance {
+        int goalX;
+        int goalY;
+
+        double estimate(int x, int y, int) const {
+            double dx = x - goalX;
+            double dy = y - goalY;
+            return std::sqrt(dx * dx + dy * dy);
+        }
+    };
+
+    // ALT: the best landmark bound, or the base heuristic where that is better
+    template <class Base>
+    struct LandmarkDistance {
+        Base base;
+        const LandmarkTable& table;
+        const float* goalDistances;
+
+        double estimate(int x, int y, int cell) const {
+            return std::max(base.estimate(x, y, cell), table.getLowerBound(goalDistances, cell));
+        }
+    };
+
+    // Calls visit once per move with the move index as a compile-time constant, so each
+    // instantiation of the search gets its moves unrolled and diagonal-only code dropped
+    template <class Visit, int... Moves>
+    void forEachMove(Visit&& visit, std::integer_sequence<int, Moves...>) {
+        (visit(std::integral_constant<int, Moves>{}), ...);
+    }
+}
 
 Pathfinder::Pathfinder(int gameFieldWidth, int gameFieldHeight)
-    : gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight) {}
+    : gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight),
+    engine(PathfinderEngine::DenseAStar), connectivity(PathConnectivity::Four), heuristic(PathHeuristic::Manhattan), hierarchy(nullptr), pathCache(nullptr), influenceMap(nullptr), influenceWeight(0.0),
+    landmarks(nullptr),
+    lastExpansionCount(0), lastPathPartial(false) {}
+
+double Pathfinder::getStepCost(const OccupancyGrid& grid, int cell) {
+    double cost = getStaticStepCost(grid, cell);
+    if (grid.isOccupiedCell(cell)) {
+        cost += agentCost;
+    }
+    return cost;
+}
+
+double Pathfinder::getStaticStepCost(const OccupancyGrid& grid, int cell) {
+    return baseCost + grid.getOverlayCost(cell);
+}
 
 std::vector<std::pair<int, int>> Pathfinder::findPath(int startX, int startY, int goalX, int goalY,
+    const std::vector<std::pair<int, int>>& enemyPositions,
+    const std::vector<std::pair<int, int>>& agentPositions) {
+    lastPathPartial = false;
+    if (engine == PathfinderEngine::HashMapAStar) {
+        return findPathHashMap(startX, startY, goalX, goalY, enemyPositions, agentPositions);
+    }
+    return findPathDense(startX, startY, goalX, goalY, enemyPositions, agentPositions);
+}
+
+std::vector<std::pair<int, int>> Pathfinder::findPathHashMap(int startX, int startY, int goalX, int goalY,
     const std::vector<std::pair<int, int>>& enemyPositions,
     const std::vector<std::pair<int, int>>& agentPositions) {
     struct NodeComparator {
@@ -22,54 +412,646 @@ std::vector<std::pair<int, int>> Pathfinder::findPath(int startX, int startY, in
         }
     };
 
-    std::vector<std::tuple<double, double, std::pair<int, int>>> openSet;
-    NodeComparator comparator;
-    std::unordered_set<std::pair<int, int>, pair_hash> closedSet;
-    std::unordered_map<std::pair<int, int>, std::pair<int, int>, pair_hash> cameFrom;
-    std::unordered_map<std::pair<int, int>, double, pair_hash> gScore;
-
     auto heuristic = [&](int x, int y) {
         return std::abs(x - goalX) + std::abs(y - goalY);
         };
 
-    gScore[{startX, startY}] = 0.0;
-    openSet.emplace_back(heuristic(startX, startY), 0.0, std::make_pair(startX, startY));
-    std::make_heap(openSet.begin(), openSet.end(), comparator);
+    lastExpansionCount = 0;
+    std::vector<std::pair<int, int>> path;
+    std::size_t heapBytes = searchMemory.allocatedBytes;
+    {
+        // Every container of this search lives in the thread's buffer and goes with arena
+        std::pmr::monotonic_buffer_resource arena(hashSearchBuffer.data(), hashSearchBuffer.size(), &searchMemory);
+        std::pmr::vector<std::tuple<double, double, std::pair<int, int>>> openSet(&arena);
+        NodeComparator comparator;
+        std::pmr::unordered_set<std::pair<int, int>, pair_hash> closedSet(&arena);
+        std::pmr::unordered_map<std::pair<int, int>, std::pair<int, int>, pair_hash> cameFrom(&arena);
+        std::pmr::unordered_map<std::pair<int, int>, double, pair_hash> gScore(&arena);
 
-    while (!openSet.empty()) {
-        std::pop_heap(openSet.begin(), openSet.end(), comparator);
-        auto [_, currentGScore, current] = openSet.back();
-        openSet.pop_back();
+        gScore[{startX, startY}] = 0.0;
+        openSet.emplace_back(heuristic(startX, startY), 0.0, std::make_pair(startX, startY));
+        std::make_heap(openSet.begin(), openSet.end(), comparator);
 
-        if (current == std::make_pair(goalX, goalY)) {
-            std::vector<std::pair<int, int>> path;
-            while (current != std::make_pair(startX, startY)) {
-                path.push_back(current);
-                current = cameFrom[current];
+        std::pair<int, int> neighbors[4];
+        while (!openSet.empty()) {
+            std::pop_heap(openSet.begin(), openSet.end(), comparator);
+            auto [_, currentGScore, current] = openSet.back();
+            openSet.pop_back();
+
+            if (current == std::make_pair(goalX, goalY)) {
+                std::size_t length = 1;
+                for (auto cell = current; cell != std::make_pair(startX, startY); cell = cameFrom[cell]) {
+                    ++length;
+                }
+                path.resize(length);
+                for (std::size_t i = length; i-- > 0; current = cameFrom[current]) {
+                    path[i] = current;
+                    if (i == 0) {
+                        break;
+                    }
+                }
+                break;
             }
-            path.push_back({ startX, startY });
-            std::reverse(path.begin(), path.end());
+
+            if (closedSet.count(current) > 0) {
+                continue;
+            }
+
+            closedSet.insert(current);
+            ++lastExpansionCount;
+
+            int neighborCount = getNeighbors(current.first, current.second, enemyPositions, agentPositions, neighbors);
+            for (int i = 0; i < neighborCount; ++i) {
+                const std::pair<int, int>& neighbor = neighbors[i];
+                if (closedSet.count(neighbor) > 0) {
+                    continue;
+                }
+
+                double tentativeGScore = currentGScore + getCost(current, neighbor, enemyPositions, agentPositions);
+                if (gScore.count(neighbor) == 0 || tentativeGScore < gScore[neighbor]) {
+                    cameFrom[neighbor] = current;
+                    gScore[neighbor] = tentativeGScore;
+                    double fScore = tentativeGScore + heuristic(neighbor.first, neighbor.second);
+                    openSet.emplace_back(fScore, tentativeGScore, neighbor);
+                    std::push_heap(openSet.begin(), openSet.end(), comparator);
+                }
+            }
+        }
+    }
+
+    std::size_t spilledBytes = searchMemory.allocatedBytes - heapBytes;
+    if (spilledBytes != 0) {
+        hashSearchBuffer.resize(hashSearchBuffer.size() + spilledBytes);
+    }
+    return path;
+}
+
+template <class Obstacles>
+std::vector<std::pair<int, int>> Pathfinder::dispatchDenseSearch(int startX, int startY, int goalX, int goalY,
+    const Obstacles& obstacles, const SearchBudget* budget, SuspendedSearch* suspended) {
+    // Landmark bounds need tables that cover this connectivity, which also rules out the
+    // position list searches, whose costs the tables know nothing about
+    bool useLandmarks = heuristic == PathHeuristic::Landmarks && landmarks != nullptr &&
+        landmarks->isUsableFor(connectivity) && std::is_same_v<Obstacles, GridObstacles>;
+    const float* goalDistances = useLandmarks ? landmarks->getDistances(goalY * gameFieldWidth + goalX) : nullptr;
+
+    if (connectivity == PathConnectivity::Eight) {
+        OctileDistance octile{ goalX, goalY };
+        if (useLandmarks) {
+            LandmarkDistance<OctileDistance> alt{ octile, *landmarks, goalDistances };
+            return runDenseSearch<EightConnected>(startX, startY, goalX, goalY, alt, obstacles, budget, suspended);
+        }
+        switch (heuristic) {
+        case PathHeuristic::Manhattan:
+            return runDenseSearch<EightConnected>(startX, startY, goalX, goalY, ManhattanDistance{ goalX, goalY }, obstacles,
+                budget, suspended);
+        case PathHeuristic::Euclidean:
+            return runDenseSearch<EightConnected>(startX, startY, goalX, goalY, EuclideanDistance{ goalX, goalY }, obstacles,
+                budget, suspended);
+        default:
+            return runDenseSearch<EightConnected>(startX, startY, goalX, goalY, octile, obstacles, budget, suspended);
+        }
+    }
+
+    ManhattanDistance manhattan{ goalX, goalY };
+    if (useLandmarks) {
+        LandmarkDistance<ManhattanDistance> alt{ manhattan, *landmarks, goalDistances };
+        return runDenseSearch<FourConnected>(startX, startY, goalX, goalY, alt, obstacles, budget, suspended);
+    }
+    switch (heuristic) {
+    case PathHeuristic::Octile:
+        return runDenseSearch<FourConnected>(startX, startY, goalX, goalY, OctileDistance{ goalX, goalY }, obstacles,
+            budget, suspended);
+    case PathHeuristic::Euclidean:
+        return runDenseSearch<FourConnected>(startX, startY, goalX, goalY, EuclideanDistance{ goalX, goalY }, obstacles,
+            budget, suspended);
+    default:
+        return runDenseSearch<FourConnected>(startX, startY, goalX, goalY, manhattan, obstacles, budget, suspended);
+    }
+}
+
+template <class Connectivity, class Heuristic, class Obstacles>
+std::vector<std::pair<int, int>> Pathfinder::runDenseSearch(int startX, int startY, int goalX, int goalY,
+    const Heuristic& estimator, const Obstacles& obstacles, const SearchBudget* budget, SuspendedSearch* suspended) {
+    DenseSearchScratch& scratch = denseScratch;
+    scratch.prepare(gameFieldWidth, gameFieldHeight);
+
+    // Same ordering as the hash map engine: a min-heap on fScore
+    auto comparator = [](const std::tuple<double, double, int>& a, const std::tuple<double, double, int>& b) {
+        return std::get<0>(a) > std::get<0>(b);
+        };
+
+    // Diagonal costs are irrational, so the fScores of equally short paths differ in the last
+    // bits and the open set would wander between them. Inflating the estimate by a hair makes
+    // nodes nearer the goal win those near-ties, at most a 1e-7 fraction off the optimum.
+    constexpr double heuristicScale = Connectivity::moveCount == 8 ? 1.0 + 1e-7 : 1.0;
+    auto heuristic = [&](int x, int y) {
+        return heuristicScale * estimator.estimate(x, y, y * gameFieldWidth + x);
+        };
+
+    const int startCell = startY * gameFieldWidth + startX;
+    const int goalCell = goalY * gameFieldWidth + goalX;
+
+    // Putting a suspended tree back counts against the time budget too. The clock is only
+    // read every 64 expansions.
+    std::chrono::steady_clock::time_point deadline;
+    if (budget != nullptr && budget->maxMicroseconds != 0) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budget->maxMicroseconds);
+    }
+
+    // A suspended search toward the same goal is put back into the scratch and carries on as
+    // long as the start is one of its cells, which it is while the caller follows its path
+    int rootCell = startCell;
+    bool resumed = false;
+    if (suspended != nullptr && suspended->active && suspended->goalCell == goalCell) {
+        for (const SuspendedSearch::Record& record : suspended->records) {
+            scratch.setScore(record.cell, record.gScore, record.parent);
+            if (record.closed) {
+                scratch.close(record.cell);
+            }
+            scratch.touched.push_back(record.cell);
+        }
+        if (scratch.hasScore(startCell)) {
+            scratch.openSet.assign(suspended->openSet.begin(), suspended->openSet.end());
+            rootCell = suspended->rootCell;
+            resumed = true;
+        }
+        else {
+            scratch.prepare(gameFieldWidth, gameFieldHeight);
+            suspended->clear();
+        }
+    }
+    else if (suspended != nullptr) {
+        suspended->clear();
+    }
+
+    if (!resumed) {
+        scratch.setScore(startCell, 0.0, startCell);
+        scratch.openSet.emplace_back(heuristic(startX, startY), 0.0, startCell);
+        if (suspended != nullptr) {
+            scratch.touched.push_back(startCell);
+            suspended->active = true;
+            suspended->rootCell = startCell;
+            suspended->goalCell = goalCell;
+            suspended->bestCell = startCell;
+        }
+    }
+
+    auto isOverBudget = [&]() {
+        if (budget->maxExpansions != 0 && lastExpansionCount >= budget->maxExpansions) {
+            return true;
+        }
+        if (budget->maxTotalExpansions != 0 && suspended->expansionCount + lastExpansionCount >= budget->maxTotalExpansions) {
+            return true;
+        }
+        return budget->maxMicroseconds != 0 && (lastExpansionCount & 63) == 0 && lastExpansionCount != 0 &&
+            std::chrono::steady_clock::now() >= deadline;
+        };
+
+    // Paths out of a resumed tree may cross cells that became occupied since it was grown,
+    // so they stop short of the first one and count as partial
+    auto finishPath = [&](int targetCell) {
+        std::vector<std::pair<int, int>> path = traceTree(scratch, gameFieldWidth, startCell, targetCell, rootCell);
+        for (std::size_t i = 1; i < path.size(); ++i) {
+            int cell = path[i].second * gameFieldWidth + path[i].first;
+            if (!obstacles.isPassable(path[i].first, path[i].second, cell)) {
+                path.resize(i);
+                lastPathPartial = true;
+                break;
+            }
+        }
+        return path;
+        };
+
+    while (!scratch.openSet.empty()) {
+        if (budget != nullptr && isOverBudget()) {
+            // Hand out the way toward the closest cell so far and keep the tree for the next
+            // slice, unless this search has had all it may get
+            int bestCell = suspended->bestCell;
+            bool exhausted = budget->maxTotalExpansions != 0 &&
+                suspended->expansionCount + lastExpansionCount >= budget->maxTotalExpansions;
+            if (exhausted) {
+                suspended->clear();
+            }
+            else {
+                suspended->expansionCount += lastExpansionCount;
+                suspended->records.clear();
+                for (int cell : scratch.touched) {
+                    suspended->records.push_back({ cell, scratch.cameFrom[cell], scratch.gScore[cell], scratch.isClosed(cell) });
+                }
+                suspended->openSet.assign(scratch.openSet.begin(), scratch.openSet.end());
+            }
+
+            std::vector<std::pair<int, int>> path = finishPath(bestCell);
+            lastPathPartial = true;
             return path;
         }
 
-        if (closedSet.count(current) > 0) {
+        std::pop_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+        auto [_, currentGScore, currentCell] = scratch.openSet.back();
+        scratch.openSet.pop_back();
+
+        if (currentCell == goalCell) {
+            if (suspended != nullptr) {
+                suspended->clear();
+                return finishPath(goalCell);
+            }
+
+            return traceParents(scratch, gameFieldWidth, startCell, goalCell);
+        }
+
+        if (scratch.isClosed(currentCell)) {
             continue;
         }
 
-        closedSet.insert(current);
+        scratch.close(currentCell);
+        ++lastExpansionCount;
+
+        int x = currentCell % gameFieldWidth;
+        int y = currentCell / gameFieldWidth;
+        if (suspended != nullptr) {
+            int bestX = suspended->bestCell % gameFieldWidth;
+            int bestY = suspended->bestCell / gameFieldWidth;
+            if (heuristic(x, y) < heuristic(bestX, bestY)) {
+                suspended->bestCell = currentCell;
+            }
+        }
+
+        auto visit = [&](auto move) {
+            constexpr int i = decltype(move)::value;
+            constexpr bool diagonal = Connectivity::dx[i] != 0 && Connectivity::dy[i] != 0;
+            int newX = x + Connectivity::dx[i];
+            int newY = y + Connectivity::dy[i];
+            if (!isValidPosition(newX, newY)) {
+                return;
+            }
+
+            int neighborCell = newY * gameFieldWidth + newX;
+            if (scratch.isClosed(neighborCell) || !obstacles.isPassable(newX, newY, neighborCell)) {
+                return;
+            }
+
+            double stepCost = obstacles.getCost(newX, newY, neighborCell);
+            if constexpr (diagonal) {
+                // No cutting corners: both cells the step brushes past must be free too
+                if (!obstacles.isPassable(newX, y, y * gameFieldWidth + newX) ||
+                    !obstacles.isPassable(x, newY, newY * gameFieldWidth + x)) {
+                    return;
+                }
+                stepCost *= diagonalLength;
+            }
+
+            double tentativeGScore = currentGScore + stepCost;
+            bool hasScore = scratch.hasScore(neighborCell);
+            if (!hasScore || tentativeGScore < scratch.gScore[neighborCell]) {
+                if (!hasScore && suspended != nullptr) {
+                    scratch.touched.push_back(neighborCell);
+                }
+                scratch.setScore(neighborCell, tentativeGScore, currentCell);
+                double fScore = tentativeGScore + heuristic(newX, newY);
+                scratch.openSet.emplace_back(fScore, tentativeGScore, neighborCell);
+                std::push_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+            }
+            };
+        forEachMove(visit, std::make_integer_sequence<int, Connectivity::moveCount>{});
+    }
 
-        for (const auto& neighbor : getNeighbors(current.first, current.second, enemyPositions, agentPositions)) {
-            if (closedSet.count(neighbor) > 0) {
+    if (suspended != nullptr) {
+        suspended->clear();
+    }
+    return std::vector<std::pair<int, int>>();
+}
+
+template <class Obstacles>
+std::vector<std::pair<int, int>> Pathfinder::runBidirectionalSearch(int startX, int startY, int goalX, int goalY,
+    const Obstacles& obstacles) {
+    DenseSearchScratch& scratch = denseScratch;
+    scratch.prepare(gameFieldWidth, gameFieldHeight);
+    scratch.prepareReverse();
+
+    auto comparator = [](const std::tuple<double, double, int>& a, const std::tuple<double, double, int>& b) {
+        return std::get<0>(a) > std::get<0>(b);
+        };
+
+    // The forward side estimates the distance to the goal and the backward side the distance
+    // to the start. Entering a cell costs at least the base cost, so both stay consistent.
+    auto forwardHeuristic = [&](int x, int y) {
+        return std::abs(x - goalX) + std::abs(y - goalY);
+        };
+    auto backwardHeuristic = [&](int x, int y) {
+        return std::abs(x - startX) + std::abs(y - startY);
+        };
+
+    const int dx[] = { -1, 0, 1, 0 };
+    const int dy[] = { 0, -1, 0, 1 };
+    const int startCell = startY * gameFieldWidth + startX;
+    const int goalCell = goalY * gameFieldWidth + goalX;
+    if (startCell == goalCell) {
+        return std::vector<std::pair<int, int>>{ { startX, startY } };
+    }
+
+    // Forward scores include the cost of entering the cell, backward scores the cost of
+    // everything after it, so a cell scored on both sides closes a path of their sum
+    scratch.setScore(startCell, 0.0, startCell);
+    scratch.openSet.emplace_back(forwardHeuristic(startX, startY), 0.0, startCell);
+    scratch.setReverseScore(goalCell, 0.0, goalCell);
+    scratch.reverseOpenSet.emplace_back(backwardHeuristic(goalX, goalY), 0.0, goalCell);
+
+    double bestCost = std::numeric_limits<double>::infinity();
+    int meetCell = -1;
+    auto meet = [&](int cell) {
+        if (scratch.hasScore(cell) && scratch.hasReverseScore(cell)) {
+            double cost = scratch.gScore[cell] + scratch.reverseGScore[cell];
+            if (cost < bestCost) {
+                bestCost = cost;
+                meetCell = cell;
+            }
+        }
+        };
+
+    for (;;) {
+        // Entries of cells closed since they were queued are dropped, so the tops are live
+        while (!scratch.openSet.empty() && scratch.isClosed(std::get<2>(scratch.openSet.front()))) {
+            std::pop_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+            scratch.openSet.pop_back();
+        }
+        while (!scratch.reverseOpenSet.empty() && scratch.isReverseClosed(std::get<2>(scratch.reverseOpenSet.front()))) {
+            std::pop_heap(scratch.reverseOpenSet.begin(), scratch.reverseOpenSet.end(), comparator);
+            scratch.reverseOpenSet.pop_back();
+        }
+        if (scratch.openSet.empty() || scratch.reverseOpenSet.empty()) {
+            break;
+        }
+
+        // Any path not met yet runs through an open cell of each side, so it costs at least
+        // the smallest key on either side. Once the best meeting is no worse than the larger
+        // of the two, it is a shortest path, whatever the step costs.
+        double forwardMin = std::get<0>(scratch.openSet.front());
+        double backwardMin = std::get<0>(scratch.reverseOpenSet.front());
+        if (bestCost <= std::max(forwardMin, backwardMin)) {
+            break;
+        }
+
+        // Grow the side with the smaller frontier, which is the open end in a crowded query
+        if (scratch.openSet.size() <= scratch.reverseOpenSet.size()) {
+            std::pop_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+            auto [_, currentGScore, currentCell] = scratch.openSet.back();
+            scratch.openSet.pop_back();
+            scratch.close(currentCell);
+            ++lastExpansionCount;
+            if (currentCell == goalCell) {
                 continue;
             }
 
-            double tentativeGScore = currentGScore + getCost(current, neighbor, enemyPositions, agentPositions);
-            if (gScore.count(neighbor) == 0 || tentativeGScore < gScore[neighbor]) {
-                cameFrom[neighbor] = current;
-                gScore[neighbor] = tentativeGScore;
-                double fScore = tentativeGScore + heuristic(neighbor.first, neighbor.second);
-                openSet.emplace_back(fScore, tentativeGScore, neighbor);
-                std::push_heap(openSet.begin(), openSet.end(), comparator);
+            int x = currentCell % gameFieldWidth;
+            int y = currentCell / gameFieldWidth;
+            for (int i = 0; i < 4; ++i) {
+                int newX = x + dx[i];
+                int newY = y + dy[i];
+                if (!isValidPosition(newX, newY)) {
+                    continue;
+                }
+
+                int neighborCell = newY * gameFieldWidth + newX;
+                if (scratch.isClosed(neighborCell) || !obstacles.isPassable(newX, newY, neighborCell)) {
+                    continue;
+                }
+
+                double tentativeGScore = currentGScore + obstacles.getCost(newX, newY, neighborCell);
+                if (!scratch.hasScore(neighborCell) || tentativeGScore < scratch.gScore[neighborCell]) {
+                    scratch.setScore(neighborCell, tentativeGScore, currentCell);
+                    scratch.openSet.emplace_back(tentativeGScore + forwardHeuristic(newX, newY), tentativeGScore, neighborCell);
+                    std::push_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+                    meet(neighborCell);
+                }
+            }
+        }
+        else {
+            std::pop_heap(scratch.reverseOpenSet.begin(), scratch.reverseOpenSet.end(), comparator);
+            auto [_, currentGScore, currentCell] = scratch.reverseOpenSet.back();
+            scratch.reverseOpenSet.pop_back();
+            scratch.closeReverse(currentCell);
+            ++lastExpansionCount;
+            if (currentCell == startCell) {
+                continue; // the start is never entered, so nothing leads into it
+            }
+
+            // Stepping from any neighbour onto this cell costs the same
+            int x = currentCell % gameFieldWidth;
+            int y = currentCell / gameFieldWidth;
+            double tentativeGScore = currentGScore + obstacles.getCost(x, y, currentCell);
+            for (int i = 0; i < 4; ++i) {
+                int newX = x + dx[i];
+                int newY = y + dy[i];
+                if (!isValidPosition(newX, newY)) {
+                    continue;
+                }
+
+                // The start may be occupied by the searching agent itself
+                int neighborCell = newY * gameFieldWidth + newX;
+                if (scratch.isReverseClosed(neighborCell) ||
+                    (neighborCell != startCell && !obstacles.isPassable(newX, newY, neighborCell))) {
+                    continue;
+                }
+
+                if (!scratch.hasReverseScore(neighborCell) || tentativeGScore < scratch.reverseGScore[neighborCell]) {
+                    scratch.setReverseScore(neighborCell, tentativeGScore, currentCell);
+                    scratch.reverseOpenSet.emplace_back(tentativeGScore + backwardHeuristic(newX, newY), tentativeGScore, neighborCell);
+                    std::push_heap(scratch.reverseOpenSet.begin(), scratch.reverseOpenSet.end(), comparator);
+                    meet(neighborCell);
+                }
+            }
+        }
+    }
+
+    if (meetCell == -1) {
+        return std::vector<std::pair<int, int>>();
+    }
+
+    std::size_t goalSide = 0;
+    for (int cell = meetCell; cell != goalCell; cell = scratch.reverseNext[cell]) {
+        ++goalSide;
+    }
+
+    std::vector<std::pair<int, int>> path = traceParents(scratch, gameFieldWidth, startCell, meetCell, goalSide);
+    for (int cell = meetCell; cell != goalCell;) {
+        cell = scratch.reverseNext[cell];
+        path.push_back({ cell % gameFieldWidth, cell / gameFieldWidth });
+    }
+    return path;
+}
+
+template <class Obstacles>
+std::vector<std::pair<int, int>> Pathfinder::runJumpPointSearch(int startX, int startY, int goalX, int goalY,
+    const Obstacles& obstacles) {
+    DenseSearchScratch& scratch = denseScratch;
+    scratch.prepare(gameFieldWidth, gameFieldHeight);
+
+    auto comparator = [](const std::tuple<double, double, int>& a, const std::tuple<double, double, int>& b) {
+        return std::get<0>(a) > std::get<0>(b);
+        };
+    auto heuristic = [&](int x, int y) {
+        return std::abs(x - goalX) + std::abs(y - goalY);
+        };
+    auto isFree = [&](int x, int y) {
+        return isValidPosition(x, y) && obstacles.isPassable(x, y, y * gameFieldWidth + x);
+        };
+    // Jumps assume every step costs the same, so they stop next to any soft-cost cell and
+    // the cells around it are expanded one step at a time like plain A*
+    auto isNearSoftCost = [&](int x, int y) {
+        const int ox[] = { 0, -1, 0, 1, 0 };
+        const int oy[] = { 0, 0, -1, 0, 1 };
+        for (int i = 0; i < 5; ++i) {
+            int nx = x + ox[i];
+            int ny = y + oy[i];
+            if (isValidPosition(nx, ny) && !obstacles.isUniform(nx, ny, ny * gameFieldWidth + nx)) {
+                return true;
+            }
+        }
+        return false;
+        };
+
+    const int dx[] = { -1, 0, 1, 0 };
+    const int dy[] = { 0, -1, 0, 1 };
+    const int startCell = startY * gameFieldWidth + startX;
+    const int goalCell = goalY * gameFieldWidth + goalX;
+    const std::int8_t noDirection = -1;
+
+    // With four neighbours, canonical paths take vertical steps freely and only turn from
+    // horizontal to vertical around an obstacle. A horizontal jump therefore stops at forced
+    // neighbours, while a vertical jump stops wherever a horizontal jump from it would.
+    auto jumpHorizontal = [&](int x, int y, int stepX) {
+        for (;;) {
+            // A cell can only be blocked, forced or near a soft cost within one column of an
+            // occupied or soft-cost cell in the rows around it, so skip the run before that
+            int stopColumn = obstacles.findStopColumn(x, y, stepX);
+            int skipTo = stopColumn == -1 ? (stepX > 0 ? gameFieldWidth - 1 : 0) : stopColumn - 2 * stepX;
+            if (y == goalY && (goalX - x) * stepX > 0 && (skipTo - goalX) * stepX >= 0) {
+                return isFree(goalX, goalY) ? goalCell : -1;
+            }
+            if ((skipTo - x) * stepX > 0) {
+                if (!isFree(skipTo, y)) {
+                    return -1; // the edge of the search area lies inside the run
+                }
+                x = skipTo;
+            }
+
+            x += stepX;
+            if (!isFree(x, y)) {
+                return -1;
+            }
+
+            int cell = y * gameFieldWidth + x;
+            if (cell == goalCell || isNearSoftCost(x, y)) {
+                return cell;
+            }
+            if ((isFree(x, y - 1) && !isFree(x - stepX, y - 1)) || (isFree(x, y + 1) && !isFree(x - stepX, y + 1))) {
+                return cell;
+            }
+        }
+        };
+    auto jumpVertical = [&](int x, int y, int stepY) {
+        for (;;) {
+            y += stepY;
+            if (!isFree(x, y)) {
+                return -1;
+            }
+
+            int cell = y * gameFieldWidth + x;
+            if (cell == goalCell || isNearSoftCost(x, y)) {
+                return cell;
+            }
+            if (jumpHorizontal(x, y, -1) != -1 || jumpHorizontal(x, y, 1) != -1) {
+                return cell;
+            }
+        }
+        };
+
+    auto push = [&](int cell, double gScore, int parent, std::int8_t direction) {
+        if (scratch.isClosed(cell) || (scratch.hasScore(cell) && gScore >= scratch.gScore[cell])) {
+            return;
+        }
+        scratch.setScore(cell, gScore, parent);
+        scratch.arrivalDirection[cell] = direction;
+        scratch.openSet.emplace_back(gScore + heuristic(cell % gameFieldWidth, cell / gameFieldWidth), gScore, cell);
+        std::push_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+        };
+
+    scratch.setScore(startCell, 0.0, startCell);
+    scratch.arrivalDirection[startCell] = noDirection;
+    scratch.openSet.emplace_back(heuristic(startX, startY), 0.0, startCell);
+
+    while (!scratch.openSet.empty()) {
+        std::pop_heap(scratch.openSet.begin(), scratch.openSet.end(), comparator);
+        auto [_, currentGScore, currentCell] = scratch.openSet.back();
+        scratch.openSet.pop_back();
+
+        if (currentCell == goalCell) {
+            // Jump points are joined by straight runs, fill the cells in between
+            std::size_t length = 1;
+            for (int cell = goalCell; cell != startCell; cell = scratch.cameFrom[cell]) {
+                int parent = scratch.cameFrom[cell];
+                length += std::abs(parent % gameFieldWidth - cell % gameFieldWidth) + std::abs(parent / gameFieldWidth - cell / gameFieldWidth);
+            }
+
+            std::vector<std::pair<int, int>> path(length);
+            std::size_t index = length;
+            for (int cell = goalCell; cell != startCell; cell = scratch.cameFrom[cell]) {
+                int parent = scratch.cameFrom[cell];
+                int stepX = (parent % gameFieldWidth > cell % gameFieldWidth) ? 1 : (parent % gameFieldWidth < cell % gameFieldWidth) ? -1 : 0;
+                int stepY = (parent / gameFieldWidth > cell / gameFieldWidth) ? 1 : (parent / gameFieldWidth < cell / gameFieldWidth) ? -1 : 0;
+                for (int run = cell; run != parent; run += stepY * gameFieldWidth + stepX) {
+                    path[--index] = { run % gameFieldWidth, run / gameFieldWidth };
+                }
+            }
+            path[0] = { startX, startY };
+            return path;
+        }
+
+        if (scratch.isClosed(currentCell)) {
+            continue;
+        }
+
+        scratch.close(currentCell);
+        ++lastExpansionCount;
+
+        int x = currentCell % gameFieldWidth;
+        int y = currentCell / gameFieldWidth;
+
+        if (isNearSoftCost(x, y)) {
+            // Ordinary expansion. The neighbours get no arrival direction, so if they are
+            // clear of soft cells again they jump in all four directions like a start node.
+            for (int i = 0; i < 4; ++i) {
+                int newX = x + dx[i];
+                int newY = y + dy[i];
+                if (isFree(newX, newY)) {
+                    int neighborCell = newY * gameFieldWidth + newX;
+                    push(neighborCell, currentGScore + obstacles.getCost(newX, newY, neighborCell), currentCell, noDirection);
+                }
+            }
+            continue;
+        }
+
+        std::int8_t arrival = scratch.arrivalDirection[currentCell];
+        for (std::int8_t i = 0; i < 4; ++i) {
+            if (arrival != noDirection && i == (arrival + 2) % 4) {
+                continue; // never jump back the way we came
+            }
+
+            bool horizontal = dx[i] != 0;
+            if (arrival != noDirection && dx[arrival] != 0 && !horizontal) {
+                // After a horizontal jump, only turn vertical around a forced neighbour
+                if (!isFree(x, y + dy[i]) || isFree(x - dx[arrival], y + dy[i])) {
+                    continue;
+                }
+            }
+
+            int target = horizontal ? jumpHorizontal(x, y, dx[i]) : jumpVertical(x, y, dy[i]);
+            if (target != -1) {
+                int targetX = target % gameFieldWidth;
+                int targetY = target / gameFieldWidth;
+                int distance = std::abs(targetX - x) + std::abs(targetY - y);
+                push(target, currentGScore + distance * obstacles.getCost(targetX, targetY, target), currentCell, i);
             }
         }
     }
@@ -77,22 +1059,182 @@ std::vector<std::pair<int, int>> Pathfinder::findPath(int startX, int startY, in
     return std::vector<std::pair<int, int>>();
 }
 
-std::vector<std::pair<int, int>> Pathfinder::getNeighbors(int x, int y,
+std::vector<std::pair<int, int>> Pathfinder::findPathDense(int startX, int startY, int goalX, int goalY,
     const std::vector<std::pair<int, int>>& enemyPositions,
     const std::vector<std::pair<int, int>>& agentPositions) {
-    std::vector<std::pair<int, int>> neighbors;
+    lastExpansionCount = 0;
+
+    // A goal outside the field or on an occupied cell can never be expanded, so skip the
+    // search that would otherwise flood the whole grid before giving up
+    if (!isValidPosition(startX, startY) || !isValidPosition(goalX, goalY)) {
+        return std::vector<std::pair<int, int>>();
+    }
+    if ((goalX != startX || goalY != startY) &&
+        (isEnemyPosition(goalX, goalY, enemyPositions) || isAgentPosition(goalX, goalY, agentPositions))) {
+        return std::vector<std::pair<int, int>>();
+    }
+
+    // Jump point and bidirectional search only know orthogonal moves
+    PositionListObstacles obstacles{ enemyPositions, agentPositions };
+    if (connectivity == PathConnectivity::Four && engine == PathfinderEngine::JumpPointSearch) {
+        return runJumpPointSearch(startX, startY, goalX, goalY, obstacles);
+    }
+    if (connectivity == PathConnectivity::Four && engine == PathfinderEngine::BidirectionalAStar) {
+        return runBidirectionalSearch(startX, startY, goalX, goalY, obstacles);
+    }
+    return dispatchDenseSearch(startX, startY, goalX, goalY, obstacles);
+}
+
+std::vector<std::pair<int, int>> Pathfinder::findPath(int startX, int startY, int goalX, int goalY,
+    const OccupancyGrid& grid) {
+    std::vector<std::pair<int, int>> path;
+    if (pathCache != nullptr && pathCache->lookup(grid, connectivity, startX, startY, goalX, goalY, path) && !crossesThreat(path)) {
+        lastExpansionCount = 0;
+        lastPathPartial = false;
+        return path;
+    }
+
+    if (hierarchy != nullptr && isValidPosition(startX, startY) && isValidPosition(goalX, goalY) &&
+        std::abs(goalX - startX) + std::abs(goalY - startY) > hierarchy->getShortQueryDistance()) {
+        // The hierarchy is shared, so the query itself leaves its state alone
+        hierarchy->sync(grid);
+        path = hierarchy->findPath(startX, startY, goalX, goalY, grid, *this, lastPathPartial, lastExpansionCount);
+    }
+    else {
+        path = findPath(startX, startY, goalX, goalY, grid, SearchBounds{ 0, 0, gameFieldWidth - 1, gameFieldHeight - 1 });
+    }
+
+    // Partial paths end wherever the refinement stopped, so they are no use to anyone else
+    if (pathCache != nullptr && !lastPathPartial) {
+        pathCache->store(grid, connectivity, path);
+    }
+    return path;
+}
+
+std::vector<std::pair<int, int>> Pathfinder::findPath(int startX, int startY, int goalX, int goalY,
+    const OccupancyGrid& grid, const SearchBounds& bounds) {
+    lastExpansionCount = 0;
+    lastPathPartial = false;
+
+    if (!isValidPosition(startX, startY) || !isValidPosition(goalX, goalY)) {
+        return std::vector<std::pair<int, int>>();
+    }
+
+    GridObstacles obstacles{ grid, goalY * gameFieldWidth + goalX, bounds, influenceMap, influenceWeight };
+    if (connectivity == PathConnectivity::Four && engine == PathfinderEngine::JumpPointSearch) {
+        return runJumpPointSearch(startX, startY, goalX, goalY, obstacles);
+    }
+    if (connectivity == PathConnectivity::Four && engine == PathfinderEngine::BidirectionalAStar) {
+        return runBidirectionalSearch(startX, startY, goalX, goalY, obstacles);
+    }
+    return dispatchDenseSearch(startX, startY, goalX, goalY, obstacles);
+}
+
+std::vector<std::pair<int, int>> Pathfinder::findPath(int startX, int startY, int goalX, int goalY,
+    const OccupancyGrid& grid, const SearchBudget& budget, SuspendedSearch& suspended) {
+    lastExpansionCount = 0;
+    lastPathPartial = false;
+
+    if (!isValidPosition(startX, startY) || !isValidPosition(goalX, goalY)) {
+        suspended.clear();
+        return std::vector<std::pair<int, int>>();
+    }
+
+    // A search still under way is continued rather than looked up again
+    int goalCell = goalY * gameFieldWidth + goalX;
+    std::vector<std::pair<int, int>> path;
+    if (!suspended.active || suspended.goalCell != goalCell) {
+        if (pathCache != nullptr && pathCache->lookup(grid, connectivity, startX, startY, goalX, goalY, path) && !crossesThreat(path)) {
+            suspended.clear();
+            return path;
+        }
+
+        // Hierarchical queries refine only a few edges, so they stay cheap without a budget
+        if (hierarchy != nullptr && std::abs(goalX - startX) + std::abs(goalY - startY) > hierarchy->getShortQueryDistance()) {
+            suspended.clear();
+            hierarchy->sync(grid);
+            path = hierarchy->findPath(startX, startY, goalX, goalY, grid, *this, lastPathPartial, lastExpansionCount);
+            if (pathCache != nullptr && !lastPathPartial) {
+                pathCache->store(grid, connectivity, path);
+            }
+            return path;
+        }
+    }
+
+    GridObstacles obstacles{ grid, goalCell, SearchBounds{ 0, 0, gameFieldWidth - 1, gameFieldHeight - 1 }, influenceMap,
+        influenceWeight };
+    path = dispatchDenseSearch(startX, startY, goalX, goalY, obstacles, &budget, &suspended);
+    if (pathCache != nullptr && !lastPathPartial) {
+        pathCache->store(grid, connectivity, path);
+    }
+    return path;
+}
+
+std::vector<PathResult> Pathfinder::findPaths(const std::vector<PathQuery>& queries, const OccupancyGrid& grid,
+    ThreadPool& pool) const {
+    // Bring the shared hierarchy up to date first, the workers only read it
+    if (hierarchy != nullptr) {
+        hierarchy->sync(grid);
+    }
+
+    std::vector<PathResult> results(queries.size());
+    pool.parallelFor(queries.size(), [&](std::size_t index) {
+        const PathQuery& query = queries[index];
+        Pathfinder worker(*this);
+        if (query.influence != nullptr) {
+            worker.influenceMap = query.influence;
+        }
+        worker.connectivity = query.connectivity;
+        worker.heuristic = query.heuristic;
+        PathResult& result = results[index];
+        if (query.suspended != nullptr) {
+            result.path = worker.findPath(query.startX, query.startY, query.goalX, query.goalY, grid, query.budget,
+                *query.suspended);
+        }
+        else if (query.bounded) {
+            result.path = worker.findPath(query.startX, query.startY, query.goalX, query.goalY, grid, query.bounds);
+        }
+        else {
+            result.path = worker.findPath(query.startX, query.startY, query.goalX, query.goalY, grid);
+        }
+        result.partial = worker.lastPathPartial;
+        result.expansionCount = worker.lastExpansionCount;
+        });
+    return results;
+}
+
+bool Pathfinder::crossesThreat(const std::vector<std::pair<int, int>>& path) const {
+    if (influenceMap == nullptr) {
+        return false;
+    }
+    for (const auto& cell : path) {
+        if (influenceMap->sample(cell.first, cell.second) != 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Pathfinder::getNeighbors(int x, int y,
+    const std::vector<std::pair<int, int>>& enemyPositions,
+    const std::vector<std::pair<int, int>>& agentPositions, std::pair<int, int> (&neighbors)[4]) {
     const int dx[] = { -1, 0, 1, 0 };
     const int dy[] = { 0, -1, 0, 1 };
 
+    int count = 0;
     for (int i = 0; i < 4; ++i) {
         int newX = x + dx[i];
         int newY = y + dy[i];
         if (isValidPosition(newX, newY) && !isEnemyPosition(newX, newY, enemyPositions) && !isAgentPosition(newX, newY, agentPositions)) {
-            neighbors.push_back({ newX, newY });
+            neighbors[count++] = { newX, newY };
         }
     }
 
-    return neighbors;
+    return count;
+}
+
+std::size_t Pathfinder::getThreadAllocationCount() {
+    return searchMemory.allocationCount;
 }
 
 bool Pathfinder::isValidPosition(int x, int y) {
@@ -110,10 +1252,6 @@ bool Pathfinder::isAgentPosition(int x, int y, const std::vector<std::pair<int,
 double Pathfinder::getCost(const std::pair<int, int>& current, const std::pair<int, int>& neighbor,
     const std::vector<std::pair<int, int>>& enemyPositions,
     const std::vector<std::pair<int, int>>& agentPositions) {
-    double baseCost = 1.0;
-    double enemyCost = 10.0;
-    double agentCost = 5.0;
-
     if (isEnemyPosition(neighbor.first, neighbor.second, enemyPositions)) {
         return baseCost + enemyCost;
     }
@@ -4,6 +4,16 @@
 #include <vector>
 #include <utility>
 #include <unordered_map>
+#include <tuple>
+#include <cstddef>
+#include <cstdint>
+
+class OccupancyGrid;
+class HierarchicalPathfinder;
+class PathCache;
+class ThreadPool;
+class InfluenceMap;
+class LandmarkTable;
 
 struct pair_hash {
     template <class T1, class T2>
@@ -14,6 +24,90 @@ struct pair_hash {
     }
 };
 
+enum class PathfinderEngine {
+    HashMapAStar,    // node state kept in hash containers keyed by cell coordinates
+    DenseAStar,      // node state kept in cell-indexed arrays reused between calls
+    JumpPointSearch,  // dense arrays, but straight runs of uniform-cost cells are skipped
+    BidirectionalAStar // dense arrays, searching from the start and the goal at once
+};
+
+// Moves a grid search may make from a cell
+enum class PathConnectivity {
+    Four,  // orthogonal steps only
+    Eight  // orthogonal and diagonal steps, diagonals never squeezing between two cells
+};
+
+// Estimate of the remaining cost a grid search is steered by
+enum class PathHeuristic {
+    Manhattan, // exact on an empty four-connected grid, overestimates diagonal steps
+    Octile,    // exact on an empty eight-connected grid
+    Euclidean, // never overestimates, but is the loosest of the three
+    Landmarks  // ALT bounds from the attached landmark table, never below Manhattan or octile
+};
+
+// Inclusive cell rectangle a search may not leave
+struct SearchBounds {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+};
+
+// Limits for one slice of a budgeted search, 0 means no limit
+struct SearchBudget {
+    std::size_t maxExpansions = 0;
+    std::int64_t maxMicroseconds = 0;
+    std::size_t maxTotalExpansions = 50000; // over all the slices of one resumed search
+};
+
+// Tree of a budgeted search that ran out of budget. The caller keeps it between ticks so the
+// next query toward the same goal carries on from it instead of starting over.
+struct SuspendedSearch {
+    struct Record {
+        int cell;
+        int parent;
+        double gScore;
+        bool closed;
+    };
+
+    bool active = false;
+    int rootCell = 0;
+    int goalCell = 0;
+    int bestCell = 0;             // closed cell closest to the goal so far
+    std::size_t expansionCount = 0;
+    std::vector<Record> records;
+    std::vector<std::tuple<double, double, int>> openSet;
+
+    void clear() {
+        active = false;
+        expansionCount = 0;
+        records.clear();
+        openSet.clear();
+    }
+};
+
+// One query of a batch. Unbounded queries go through the hierarchy and the path cache like
+// the plain grid findPath, bounded ones are flat searches confined to the rectangle.
+struct PathQuery {
+    int startX;
+    int startY;
+    int goalX;
+    int goalY;
+    bool bounded = false;
+    SearchBounds bounds = {};
+    SuspendedSearch* suspended = nullptr; // makes the query a budgeted one when set
+    SearchBudget budget = {};
+    const InfluenceMap* influence = nullptr; // replaces the pathfinder's influence map when set
+    PathConnectivity connectivity = PathConnectivity::Four;
+    PathHeuristic heuristic = PathHeuristic::Manhattan;
+};
+
+struct PathResult {
+    std::vector<std::pair<int, int>> path;
+    bool partial = false;
+    std::size_t expansionCount = 0;
+};
+
 class Pathfinder {
 public:
     Pathfinder(int gameFieldWidth, int gameFieldHeight);
@@ -22,13 +116,116 @@ public:
         const std::vector<std::pair<int, int>>& enemyPositions,
         const std::vector<std::pair<int, int>>& agentPositions);
 
+    // Same search against the shared per-tick occupancy grid. Obstacle checks are O(1) and the
+    // grid's cost overlay is added to every step. Uses jump point search or the bidirectional
+    // search when selected and the dense engine otherwise, or the hierarchy for queries longer
+    // than its short-query distance when one is attached. With a path cache attached,
+    // complete paths are looked up there first and stored there afterwards.
+    std::vector<std::pair<int, int>> findPath(int startX, int startY, int goalX, int goalY,
+        const OccupancyGrid& grid);
+
+    // Flat search confined to the given rectangle
+    std::vector<std::pair<int, int>> findPath(int startX, int startY, int goalX, int goalY,
+        const OccupancyGrid& grid, const SearchBounds& bounds);
+
+    // Budgeted search against the grid. Hierarchy and cache are used as usual, but a flat
+    // search that runs out of budget returns the path to the cell it got closest to the goal,
+    // marked partial, and leaves its tree in suspended. Asking again for the same goal from a
+    // cell of that tree, such as one along the returned path, continues the search. Cells
+    // that changed in between are only checked on the final path, which stops short of any
+    // that became occupied. Always uses the dense engine.
+    std::vector<std::pair<int, int>> findPath(int startX, int startY, int goalX, int goalY,
+        const OccupancyGrid& grid, const SearchBudget& budget, SuspendedSearch& suspended);
+
+    // Solves independent queries against the same grid on the pool's threads. Each query runs
+    // on a copy of this pathfinder's settings, with the query's connectivity and heuristic,
+    // and with its thread's search scratch, so a result is the path findPath would have
+    // returned, except that which queries hit the path cache depends on the order they finish
+    // in. The grid must not change until this returns.
+    std::vector<PathResult> findPaths(const std::vector<PathQuery>& queries, const OccupancyGrid& grid,
+        ThreadPool& pool) const;
+
+    // Cost of stepping onto a cell of the grid
+    static double getStepCost(const OccupancyGrid& grid, int cell);
+
+    // The part of it that does not depend on where the agents stand
+    static double getStaticStepCost(const OccupancyGrid& grid, int cell);
+
+    // Heap allocations the search scratch of the calling thread has made so far. Every engine
+    // keeps its working state in per-thread buffers that are reused across queries, so once
+    // they have grown to the thread's largest search this stops moving. The path a query
+    // returns is not counted; it is allocated once at its final size.
+    static std::size_t getThreadAllocationCount();
+
+    void setEngine(PathfinderEngine engine) { this->engine = engine; }
+    PathfinderEngine getEngine() const { return engine; }
+
+    // Every combination of connectivity and heuristic is a separate instantiation of the dense
+    // search with its moves unrolled, so the choice costs one dispatch per query. Diagonal
+    // steps cost sqrt(2) times the cell they enter. Eight-connected queries always use the
+    // dense engine; the hierarchy's abstract graph stays four-connected but its refinement
+    // follows this setting. Pair eight-connectivity with the octile heuristic.
+    void setConnectivity(PathConnectivity connectivity) { this->connectivity = connectivity; }
+    PathConnectivity getConnectivity() const { return connectivity; }
+    void setHeuristic(PathHeuristic heuristic) { this->heuristic = heuristic; }
+    PathHeuristic getHeuristic() const { return heuristic; }
+    void setHierarchy(HierarchicalPathfinder* hierarchy) { this->hierarchy = hierarchy; }
+    void setPathCache(PathCache* pathCache) { this->pathCache = pathCache; }
+
+    // Threat to steer grid searches around, added to every step as weight times the threat of
+    // the cell. Flat searches and hierarchy refinement see it; the hierarchy's abstract graph
+    // does not. Cached paths crossing any threat are searched again rather than reused.
+    void setInfluenceMap(const InfluenceMap* map, double weight) {
+        influenceMap = map;
+        influenceWeight = weight;
+    }
+
+    // Distance tables for the landmark heuristic. Without usable tables for the search's
+    // connectivity it falls back to Manhattan or octile distance.
+    void setLandmarks(const LandmarkTable* landmarks) { this->landmarks = landmarks; }
+    std::size_t getLastExpansionCount() const { return lastExpansionCount; }
+
+    // True when the last path stops short of the goal and the caller should query again
+    // once it reaches the end of it, rather than treat the end as the goal
+    bool isLastPathPartial() const { return lastPathPartial; }
+
 private:
     int gameFieldWidth;
     int gameFieldHeight;
+    PathfinderEngine engine;
+    PathConnectivity connectivity;
+    PathHeuristic heuristic;
+    HierarchicalPathfinder* hierarchy;
+    PathCache* pathCache;
+    const InfluenceMap* influenceMap;
+    double influenceWeight;
+    const LandmarkTable* landmarks;
+    std::size_t lastExpansionCount;
+    bool lastPathPartial;
 
-    std::vector<std::pair<int, int>> getNeighbors(int x, int y,
+    std::vector<std::pair<int, int>> findPathHashMap(int startX, int startY, int goalX, int goalY,
+        const std::vector<std::pair<int, int>>& enemyPositions,
+        const std::vector<std::pair<int, int>>& agentPositions);
+    std::vector<std::pair<int, int>> findPathDense(int startX, int startY, int goalX, int goalY,
         const std::vector<std::pair<int, int>>& enemyPositions,
         const std::vector<std::pair<int, int>>& agentPositions);
+    template <class Obstacles>
+    std::vector<std::pair<int, int>> dispatchDenseSearch(int startX, int startY, int goalX, int goalY,
+        const Obstacles& obstacles, const SearchBudget* budget = nullptr, SuspendedSearch* suspended = nullptr);
+    template <class Connectivity, class Heuristic, class Obstacles>
+    std::vector<std::pair<int, int>> runDenseSearch(int startX, int startY, int goalX, int goalY,
+        const Heuristic& estimator, const Obstacles& obstacles, const SearchBudget* budget = nullptr, SuspendedSearch* suspended = nullptr);
+    template <class Obstacles>
+    std::vector<std::pair<int, int>> runBidirectionalSearch(int startX, int startY, int goalX, int goalY,
+        const Obstacles& obstacles);
+    template <class Obstacles>
+    std::vector<std::pair<int, int>> runJumpPointSearch(int startX, int startY, int goalX, int goalY,
+        const Obstacles& obstacles);
+    bool crossesThreat(const std::vector<std::pair<int, int>>& path) const;
+    // Fills neighbors with the free cells next to (x, y) and returns how many there are
+    int getNeighbors(int x, int y,
+        const std::vector<std::pair<int, int>>& enemyPositions,
+        const std::vector<std::pair<int, int>>& agentPositions, std::pair<int, int> (&neighbors)[4]);
     bool isValidPosition(int x, int y);
     bool isEnemyPosition(int x, int y, const std::vector<std::pair<int, int>>& enemyPositions);
     bool isAgentPosition(int x, int y, const std::vector<std::pair<int, int>>& agentPositions);
@@ -38,4 +235,4 @@ private:
 };
 
 
-#endif
\ No newline at end of file
+#endif
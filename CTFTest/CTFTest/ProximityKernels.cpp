@@ -0,0 +1,146 @@
+#include "ProximityKernels.h"
+#include "SimdSupport.h"
+#include <cmath>
+#include <limits>
+
+#if defined(SIMD_HAS_AVX2) || defined(SIMD_HAS_SSE2)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Folds the per-lane winners of a vector pass into best, keeping the lowest index on ties.
+    // Lanes that found nothing hold index -1.
+    void reduceLanes(const float* laneDistances, const int* laneIndices, int laneCount, float& best, int& bestIndex) {
+        for (int lane = 0; lane < laneCount; ++lane) {
+            int index = laneIndices[lane];
+            if (index != -1 && (laneDistances[lane] < best || (laneDistances[lane] == best && index < bestIndex))) {
+                best = laneDistances[lane];
+                bestIndex = index;
+            }
+        }
+    }
+
+    // Each vector pass scans a prefix of the points into best and bestIndex and returns how
+    // many it scanned. Each lane keeps the first point that beat its best so far, in two
+    // interleaved sets of lanes so consecutive steps do not wait on each other.
+#if defined(SIMD_HAS_AVX2)
+    SIMD_TARGET_AVX2 int scanAvx2(float x, float y, const float* pointX, const float* pointY, int pointCount,
+        float& best, int& bestIndex) {
+        int i = 0;
+        if (pointCount < 16) {
+            return i;
+        }
+
+        __m256 queryX = _mm256_set1_ps(x);
+        __m256 queryY = _mm256_set1_ps(y);
+        __m256 bestDistances[2] = { _mm256_set1_ps(best), _mm256_set1_ps(best) };
+        __m256i bestIndices[2] = { _mm256_set1_epi32(-1), _mm256_set1_epi32(-1) };
+        __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i stride = _mm256_set1_epi32(8);
+        for (; i + 16 <= pointCount; i += 16) {
+            for (int set = 0; set < 2; ++set) {
+                __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(pointX + i + 8 * set), queryX);
+                __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(pointY + i + 8 * set), queryY);
+                __m256 distances = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+                __m256 closer = _mm256_cmp_ps(distances, bestDistances[set], _CMP_LT_OQ);
+                bestDistances[set] = _mm256_min_ps(distances, bestDistances[set]);
+                bestIndices[set] = _mm256_blendv_epi8(bestIndices[set], indices, _mm256_castps_si256(closer));
+                indices = _mm256_add_epi32(indices, stride);
+            }
+        }
+        float laneDistances[16];
+        int laneIndices[16];
+        for (int set = 0; set < 2; ++set) {
+            _mm256_storeu_ps(laneDistances + 8 * set, bestDistances[set]);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(laneIndices + 8 * set), bestIndices[set]);
+        }
+        reduceLanes(laneDistances, laneIndices, 16, best, bestIndex);
+        return i;
+    }
+#endif
+
+#if defined(SIMD_HAS_SSE2)
+    int scanSse2(float x, float y, const float* pointX, const float* pointY, int pointCount, float& best, int& bestIndex) {
+        int i = 0;
+        if (pointCount < 8) {
+            return i;
+        }
+
+        __m128 queryX = _mm_set1_ps(x);
+        __m128 queryY = _mm_set1_ps(y);
+        __m128 bestDistances[2] = { _mm_set1_ps(best), _mm_set1_ps(best) };
+        __m128i bestIndices[2] = { _mm_set1_epi32(-1), _mm_set1_epi32(-1) };
+        __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i stride = _mm_set1_epi32(4);
+        for (; i + 8 <= pointCount; i += 8) {
+            for (int set = 0; set < 2; ++set) {
+                __m128 dx = _mm_sub_ps(_mm_loadu_ps(pointX + i + 4 * set), queryX);
+                __m128 dy = _mm_sub_ps(_mm_loadu_ps(pointY + i + 4 * set), queryY);
+                __m128 distances = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+                __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distances, bestDistances[set]));
+                bestDistances[set] = _mm_min_ps(distances, bestDistances[set]);
+                bestIndices[set] = _mm_or_si128(_mm_and_si128(closer, indices), _mm_andnot_si128(closer, bestIndices[set]));
+                indices = _mm_add_epi32(indices, stride);
+            }
+        }
+        float laneDistances[8];
+        int laneIndices[8];
+        for (int set = 0; set < 2; ++set) {
+            _mm_storeu_ps(laneDistances + 4 * set, bestDistances[set]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(laneIndices + 4 * set), bestIndices[set]);
+        }
+        reduceLanes(laneDistances, laneIndices, 8, best, bestIndex);
+        return i;
+    }
+#endif
+
+    int findNearest(SimdLevel level, float x, float y, const float* pointX, const float* pointY, int pointCount,
+        float maxSquaredDistance, float& squaredDistance) {
+        // A point is close enough when it is strictly below the next float above the limit
+        float best = std::nextafter(maxSquaredDistance, std::numeric_limits<float>::infinity());
+        int bestIndex = -1;
+        int i = 0;
+#if defined(SIMD_HAS_AVX2)
+        if (level == SimdLevel::Avx2) {
+            i = scanAvx2(x, y, pointX, pointY, pointCount, best, bestIndex);
+        }
+#endif
+#if defined(SIMD_HAS_SSE2)
+        if (level == SimdLevel::Sse2) {
+            i = scanSse2(x, y, pointX, pointY, pointCount, best, bestIndex);
+        }
+#endif
+        (void)level;
+
+        // The rest come after every point the lanes saw, so strictly closer keeps ties lowest
+        for (; i < pointCount; ++i) {
+            float dx = pointX[i] - x;
+            float dy = pointY[i] - y;
+            float distance = dx * dx + dy * dy;
+            if (distance < best) {
+                best = distance;
+                bestIndex = i;
+            }
+        }
+
+        squaredDistance = bestIndex != -1 ? best : std::numeric_limits<float>::infinity();
+        return bestIndex;
+    }
+}
+
+int findNearestPoint(float x, float y, const float* pointX, const float* pointY, int pointCount,
+    float maxSquaredDistance, float& squaredDistance) {
+    return findNearest(getSimdLevel(), x, y, pointX, pointY, pointCount, maxSquaredDistance, squaredDistance);
+}
+
+void findNearestPoints(const float* queryX, const float* queryY, int queryCount,
+    const float* pointX, const float* pointY, int pointCount, float maxSquaredDistance,
+    int* nearest, float* squaredDistances) {
+    // A tick's points take a few kilobytes, so every query after the first streams them from
+    // the first level cache
+    SimdLevel level = getSimdLevel();
+    for (int query = 0; query < queryCount; ++query) {
+        nearest[query] = findNearest(level, queryX[query], queryY[query], pointX, pointY, pointCount, maxSquaredDistance,
+            squaredDistances[query]);
+    }
+}
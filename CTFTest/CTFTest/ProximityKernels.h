@@ -0,0 +1,19 @@
+#ifndef PROXIMITYKERNELS_H
+#define PROXIMITYKERNELS_H
+
+// Closest-point searches over points stored as separate x and y arrays, vectorised with AVX2
+// or SSE2 as SimdSupport picks and scalar otherwise. Every path computes the same float
+// squared distances in the same order, so all of them pick the same point.
+
+// Index of the point closest to (x, y) at most maxSquaredDistance away, the lowest one on
+// ties, or -1 when there is none. squaredDistance receives the distance found.
+int findNearestPoint(float x, float y, const float* pointX, const float* pointY, int pointCount,
+    float maxSquaredDistance, float& squaredDistance);
+
+// The same search for every query point in one pass. nearest and squaredDistances hold one
+// entry per query.
+void findNearestPoints(const float* queryX, const float* queryY, int queryCount,
+    const float* pointX, const float* pointY, int pointCount, float maxSquaredDistance,
+    int* nearest, float* squaredDistances);
+
+#endif
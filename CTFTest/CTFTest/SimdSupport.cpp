@@ -0,0 +1,79 @@
+#include "SimdSupport.h"
+#include <atomic>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(SIMD_HAS_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+    // The CPU has AVX2 and the OS saves the 256-bit registers across context switches
+    bool detectAvx2() {
+#if defined(SIMD_HAS_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return osSavesAvx && (info[1] & (1 << 5)) != 0;
+#elif defined(SIMD_HAS_AVX2)
+        // Reports AVX2 only when the OS has enabled the AVX state
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+    }
+
+    std::atomic<int>& activeLevel() {
+        static std::atomic<int> level{ static_cast<int>(getSupportedSimdLevel()) };
+        return level;
+    }
+}
+
+SimdLevel getSupportedSimdLevel() {
+    static const SimdLevel supported = detectAvx2() ? SimdLevel::Avx2 :
+#if defined(SIMD_HAS_SSE2)
+        SimdLevel::Sse2;
+#else
+        SimdLevel::Scalar;
+#endif
+    return supported;
+}
+
+SimdLevel getSimdLevel() {
+    return static_cast<SimdLevel>(activeLevel().load(std::memory_order_relaxed));
+}
+
+SimdLevel setSimdLevel(SimdLevel level) {
+    SimdLevel supported = getSupportedSimdLevel();
+    SimdLevel active = static_cast<int>(level) < static_cast<int>(supported) ? level : supported;
+    activeLevel().store(static_cast<int>(active), std::memory_order_relaxed);
+    return active;
+}
+
+const char* getSimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Avx2:
+        return "avx2";
+    case SimdLevel::Sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+bool parseSimdLevel(const char* name, SimdLevel& level) {
+    for (SimdLevel candidate : { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2 }) {
+        if (std::strcmp(name, getSimdLevelName(candidate)) == 0) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
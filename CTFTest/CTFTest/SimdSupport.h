@@ -0,0 +1,45 @@
+#ifndef SIMDSUPPORT_H
+#define SIMDSUPPORT_H
+
+// Instruction sets the vector kernels are built for and the one they run with. SSE2 is the
+// baseline of every x86-64 build. AVX2 kernels are compiled into every x86 build regardless
+// of the compiler's target flags, each function marked with SIMD_TARGET_AVX2, and are only
+// called after the CPU and OS have been checked for them, so one binary runs everywhere and
+// takes the widest kernels the machine has.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_HAS_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC accepts AVX intrinsics in any function, without /arch
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_HAS_SSE2
+#endif
+
+enum class SimdLevel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Widest level both this build and the machine support
+SimdLevel getSupportedSimdLevel();
+
+// Level the kernels dispatch on, the supported one unless lowered with setSimdLevel
+SimdLevel getSimdLevel();
+
+// Makes the kernels use at most the given level, such as to compare the paths against each
+// other, and returns the level they use now. Every level computes the same results.
+SimdLevel setSimdLevel(SimdLevel level);
+
+const char* getSimdLevelName(SimdLevel level);
+
+// Reads scalar, sse2 or avx2 into level, false for anything else
+bool parseSimdLevel(const char* name, SimdLevel& level);
+
+#endif
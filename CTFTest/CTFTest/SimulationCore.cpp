@@ -0,0 +1,1090 @@
+#include "SimulationCore.h"
+#include "ProximityKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    float calculateDistance(const FieldPoint& pos1, const FieldPoint& pos2) {
+        double dx = pos1.x - pos2.x;
+        double dy = pos1.y - pos2.y;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    // A perception batch goes through the spatial hash once both sides have this many points.
+    // Below it one pass of the proximity kernels over every point is faster than building
+    // the hash and walking its cells: the teams bunch up, which leaves most cells empty.
+    const int spatialHashMinPoints = 768;
+
+    const std::uint64_t fnvOffsetBasis = 14695981039346656037ull;
+    const std::uint64_t fnvPrime = 1099511628211ull;
+
+    template <typename T>
+    void hashValue(std::uint64_t& hash, const T& value) {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (unsigned char byte : bytes) {
+            hash = (hash ^ byte) * fnvPrime;
+        }
+    }
+}
+
+SimulationCore::SimulationCore(int fieldWidth, int fieldHeight, int pathCellSize, std::uint32_t seed, unsigned workerThreads)
+    : fieldWidth(fieldWidth), fieldHeight(fieldHeight), pathCellSize(pathCellSize),
+    movementSpeed(2000.0), tagRange(200.0f), tagCooldownPeriod(30000),
+    flags{ FieldPoint{ 0.0, 0.0 }, FieldPoint{ 0.0, 0.0 } }, bases{ FieldPoint{ 0.0, 0.0 }, FieldPoint{ 0.0, 0.0 } },
+    scores{ 0, 0 },
+    occupancyGrid((fieldWidth + pathCellSize - 1) / pathCellSize, (fieldHeight + pathCellSize - 1) / pathCellSize, 20),
+    hierarchy(occupancyGrid.getWidth(), occupancyGrid.getHeight(), 20),
+    flowFields(occupancyGrid),
+    landmarks(occupancyGrid.getWidth(), occupancyGrid.getHeight(), PathConnectivity::Eight),
+    // Threat is kept on 8 pixel samples and falls off over about 60 pixels at any cell size
+    threatToBlue(occupancyGrid.getWidth(), occupancyGrid.getHeight(), std::max(1, 8 / pathCellSize),
+        20.0f / (std::max(1, 8 / pathCellSize) * pathCellSize)),
+    threatToRed(occupancyGrid.getWidth(), occupancyGrid.getHeight(), std::max(1, 8 / pathCellSize),
+        20.0f / (std::max(1, 8 / pathCellSize) * pathCellSize)),
+    threatWeight(4.0),
+    batchPathfinder(occupancyGrid.getWidth(), occupancyGrid.getHeight()), workers(workerThreads),
+    frameSearchBudget(4000), frameExpansionBudget(0), clock(0), stateHash(0), random(seed) {
+    // Long-haul queries go through the shared hierarchy, complete paths are shared through the
+    // path cache, and searches keep their distance from the other team instead of brushing
+    // past it. Diagonal steps make for shorter paths with fewer corners to walk, and paths to
+    // arbitrary points are steered by the landmark tables, which fall back to octile distance.
+    for (Team team : { Team::Blue, Team::Red }) {
+        Pathfinder pathfinder(occupancyGrid.getWidth(), occupancyGrid.getHeight());
+        pathfinder.setHierarchy(&hierarchy);
+        pathfinder.setPathCache(&pathCache);
+        pathfinder.setInfluenceMap(&getEnemyInfluence(team), threatWeight);
+        pathfinder.setConnectivity(PathConnectivity::Eight);
+        pathfinder.setHeuristic(PathHeuristic::Landmarks);
+        pathfinder.setLandmarks(&landmarks);
+        teamPathfinders.push_back(pathfinder);
+    }
+
+    // Searches batched by the step get the same hierarchy, cache and tables as the agents'
+    // own. Each query brings its team's threat map, only the weight is shared.
+    batchPathfinder.setHierarchy(&hierarchy);
+    batchPathfinder.setPathCache(&pathCache);
+    batchPathfinder.setLandmarks(&landmarks);
+    batchPathfinder.setInfluenceMap(nullptr, threatWeight);
+
+    placeLandmarks();
+    stateHash = computeStateHash();
+}
+
+void SimulationCore::setFlagPosition(Team team, const FieldPoint& position) {
+    flags[index(team)] = position;
+    placeLandmarks();
+}
+
+void SimulationCore::setBasePosition(Team team, const FieldPoint& position) {
+    bases[index(team)] = position;
+    placeLandmarks();
+}
+
+void SimulationCore::placeLandmarks() {
+    // The field corners, plus the flags and bases most long paths start or end near
+    int lastX = occupancyGrid.getWidth() - 1;
+    int lastY = occupancyGrid.getHeight() - 1;
+    std::vector<std::pair<int, int>> cells = { { 0, 0 }, { lastX, 0 }, { 0, lastY }, { lastX, lastY } };
+    for (const FieldPoint& point : { flags[0], flags[1], bases[0], bases[1] }) {
+        cells.emplace_back(static_cast<int>(point.x) / pathCellSize, static_cast<int>(point.y) / pathCellSize);
+    }
+    landmarks.setLandmarks(cells);
+}
+
+int SimulationCore::addAgent(Team team, const FieldPoint& position) {
+    agents.x.push_back(position.x);
+    agents.y.push_back(position.y);
+    agents.team.push_back(team);
+    agents.state.push_back(0);
+    agents.decision.push_back(BrainDecision::Explore);
+    agents.pathIndex.push_back(0);
+    agents.paths.emplace_back();
+    agents.middleStuckTime.push_back(0);
+    // Free to tag from the first tick
+    agents.lastTagTime.push_back(clock - tagCooldownPeriod);
+    // Its own random stream, seeded from the core's generator
+    std::uint64_t randomSeed = static_cast<std::uint64_t>(random()) << 32;
+    randomSeed |= random();
+    agents.randomState.push_back(randomSeed);
+    agents.queryTarget.push_back({ 0.0, 0.0 });
+    agents.exploreSearches.emplace_back();
+    agents.deliveredPaths.emplace_back();
+    agents.brains.emplace_back(brainParameters[index(team)]);
+    agents.chasePlanners.push_back(std::make_unique<IncrementalPlanner>(occupancyGrid.getWidth(), occupancyGrid.getHeight()));
+    return agents.size() - 1;
+}
+
+void SimulationCore::setBrainParameters(Team team, const BrainParameters& parameters) {
+    brainParameters[index(team)] = parameters;
+    for (int agent = 0; agent < agents.size(); ++agent) {
+        if (agents.team[agent] == team) {
+            agents.brains[agent] = Brain(parameters);
+        }
+    }
+}
+
+void SimulationCore::clearAgents() {
+    agents = AgentTable();
+    flagStatus = {};
+}
+
+void SimulationCore::setAgentEnabled(int agent, bool enabled) {
+    setState(agent, AgentDisabled, !enabled);
+}
+
+void SimulationCore::moveTo(int agent, const FieldPoint& point) {
+    agents.x[agent] = point.x;
+    agents.y[agent] = point.y;
+}
+
+void SimulationCore::setState(int agent, std::uint8_t bit, bool value) {
+    if (value) {
+        agents.state[agent] |= bit;
+    }
+    else {
+        agents.state[agent] &= static_cast<std::uint8_t>(~bit);
+    }
+}
+
+void SimulationCore::step(int elapsedMilliseconds) {
+    clock += elapsedMilliseconds;
+
+    // Blue agents come first in every pass
+    std::vector<int> order;
+    order.reserve(agents.size());
+    for (Team team : { Team::Blue, Team::Red }) {
+        for (int agent = 0; agent < agents.size(); ++agent) {
+            if (agents.team[agent] == team) {
+                order.push_back(agent);
+            }
+        }
+    }
+
+    // Collect the positions of all agents
+    Positions positions;
+    int blueCount = 0;
+    for (int agent : order) {
+        positions.emplace_back(static_cast<int>(agents.x[agent]), static_cast<int>(agents.y[agent]));
+        blueCount += agents.team[agent] == Team::Blue ? 1 : 0;
+    }
+
+    // Everything an agent perceives of the others this tick is the snapshot of the world as
+    // it began, so the updates below can run in any order
+    takeSnapshot();
+
+    // Per team the enemies it could tag: untagged and on their own half, across the middle
+    // line from the team's own agents
+    for (Team team : { Team::Blue, Team::Red }) {
+        PointSet& taggable = taggableBy[index(team)];
+        const PointSet& enemies = snapshot.members[index(opponentOf(team))];
+        taggable.clear();
+        for (int i = 0; i < enemies.size(); ++i) {
+            int enemy = enemies.ids[i];
+            if (!snapshot.has(enemy, AgentTagged) && isOnOwnSide(enemy)) {
+                taggable.add(enemy, enemies.x[i], enemies.y[i]);
+            }
+        }
+    }
+
+    // Perceive for every agent at once, a batch per team: how far the nearest enemy is, and
+    // which taggable enemy in tag range is closest. Agents only tag while untagged and on
+    // their own half.
+    nearestEnemyDistances.assign(agents.size(), std::numeric_limits<float>::max());
+    tagTargets.assign(agents.size(), -1);
+    for (Team team : { Team::Blue, Team::Red }) {
+        const PointSet& observers = snapshot.members[index(team)];
+        int observerCount = observers.size();
+
+        findNearestInBatch(observers, snapshot.members[index(opponentOf(team))], std::numeric_limits<float>::infinity());
+        for (int i = 0; i < observerCount; ++i) {
+            if (nearestScratch[i] != -1) {
+                nearestEnemyDistances[observers.ids[i]] = std::sqrt(squaredDistanceScratch[i]);
+            }
+        }
+
+        const PointSet& taggable = taggableBy[index(team)];
+        findNearestInBatch(observers, taggable, tagRange * tagRange);
+        for (int i = 0; i < observerCount; ++i) {
+            int agent = observers.ids[i];
+            if (nearestScratch[i] != -1 && !snapshot.has(agent, AgentTagged) && isOnOwnSide(agent)) {
+                tagTargets[agent] = taggable.ids[nearestScratch[i]];
+            }
+        }
+    }
+
+    // Rebuild the shared obstacle grid of path cells once so every path query this tick reads
+    // it in O(1), then repair the flow fields toward flags and bases from the cells that changed
+    std::vector<std::pair<int, int>> agentCells;
+    for (const auto& position : positions) {
+        agentCells.emplace_back(position.first / pathCellSize, position.second / pathCellSize);
+    }
+    occupancyGrid.setAgentPositions(agentCells);
+    flowFields.sync();
+    landmarks.sync(occupancyGrid);
+
+    // Each team's threat comes from the other team's agents
+    std::vector<std::pair<int, int>> blueCells(agentCells.begin(), agentCells.begin() + blueCount);
+    std::vector<std::pair<int, int>> redCells(agentCells.begin() + blueCount, agentCells.end());
+    threatToBlue.build(redCells);
+    threatToRed.build(blueCells);
+
+    // Decide what every agent does this tick on the worker threads, then collect the searches
+    // that needs in update order
+    std::vector<PathQuery> agentQueries(order.size());
+    std::vector<char> hasQuery(order.size(), 0);
+    workers.parallelFor(order.size(), [&](std::size_t rank) {
+        int agent = order[rank];
+        hasQuery[rank] = !agents.has(agent, AgentDisabled) && decide(agent, elapsedMilliseconds, agentQueries[rank]);
+        });
+    std::vector<int> queryAgents;
+    std::vector<PathQuery> queries;
+    for (std::size_t rank = 0; rank < order.size(); ++rank) {
+        if (hasQuery[rank]) {
+            queryAgents.push_back(order[rank]);
+            queries.push_back(agentQueries[rank]);
+        }
+    }
+
+    // Each worker thread gets its share of the frame budget to spend on its queries. An
+    // expansion budget is split the same way on any number of threads, so the searches stop
+    // at the same node on every machine.
+    if (!queries.empty() && isDeterministic()) {
+        std::size_t perQuery = frameExpansionBudget / queries.size();
+        for (PathQuery& pending : queries) {
+            pending.budget.maxExpansions = std::max<std::size_t>(perQuery, 1);
+        }
+    }
+    else if (!queries.empty()) {
+        std::int64_t perQuery = frameSearchBudget * workers.getThreadCount() / static_cast<std::int64_t>(queries.size());
+        for (PathQuery& pending : queries) {
+            pending.budget.maxMicroseconds = std::max<std::int64_t>(perQuery, 1);
+        }
+    }
+    batchPathfinder.setPathCache(isDeterministic() ? nullptr : &pathCache);
+    for (Pathfinder& pathfinder : teamPathfinders) {
+        pathfinder.setPathCache(isDeterministic() ? nullptr : &pathCache);
+    }
+
+    // Run them across the worker threads and hand the paths back before anyone moves
+    std::vector<PathResult> results = batchPathfinder.findPaths(queries, occupancyGrid, workers);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        agents.deliveredPaths[queryAgents[i]] = std::move(results[i]);
+        setState(queryAgents[i], AgentDeliveredPath, true);
+    }
+
+    // The updates plan on the worker threads too, so the hierarchy has to be brought up to
+    // date first and is only read from there on
+    hierarchy.sync(occupancyGrid);
+
+    // Update the agents. Each one only moves itself and changes its own state, what it does
+    // to the others and to the flags is held back in its effects.
+    effects.assign(agents.size(), AgentEffects());
+    workers.parallelFor(order.size(), [&](std::size_t rank) {
+        int agent = order[rank];
+        if (!agents.has(agent, AgentDisabled)) {
+            update(agent);
+        }
+        });
+
+    // Commit the effects one agent at a time in update order
+    settleFlags();
+    for (int agent : order) {
+        commitEffects(agent);
+    }
+
+    stateHash = computeStateHash();
+}
+
+void SimulationCore::takeSnapshot() {
+    int agentCount = agents.size();
+    snapshot.x.resize(agentCount);
+    snapshot.y.resize(agentCount);
+    for (int agent = 0; agent < agentCount; ++agent) {
+        snapshot.x[agent] = static_cast<float>(agents.x[agent]);
+        snapshot.y[agent] = static_cast<float>(agents.y[agent]);
+    }
+    snapshot.team = agents.team;
+    snapshot.state = agents.state;
+
+    for (PointSet& members : snapshot.members) {
+        members.clear();
+    }
+    for (int agent = 0; agent < agentCount; ++agent) {
+        snapshot.members[index(agents.team[agent])].add(agent, snapshot.x[agent], snapshot.y[agent]);
+    }
+    snapshot.flagCarrier = { flagStatus[0].carrier, flagStatus[1].carrier };
+}
+
+void SimulationCore::findNearestInBatch(const PointSet& observers, const PointSet& points, float maxSquaredDistance) {
+    int observerCount = observers.size();
+    nearestScratch.resize(observerCount);
+    squaredDistanceScratch.resize(observerCount);
+    if (observerCount < spatialHashMinPoints || points.size() < spatialHashMinPoints) {
+        findNearestPoints(observers.x.data(), observers.y.data(), observerCount, points.x.data(), points.y.data(),
+            points.size(), maxSquaredDistance, nearestScratch.data(), squaredDistanceScratch.data());
+        return;
+    }
+
+    perceptionHash.build(points.x.data(), points.y.data(), points.size());
+    perceptionHash.findNearestPoints(observers.x.data(), observers.y.data(), observerCount, maxSquaredDistance,
+        nearestScratch.data(), squaredDistanceScratch.data());
+}
+
+bool SimulationCore::decide(int agent, int elapsedTime, PathQuery& query) {
+    FieldPoint agentPos = position(agent);
+    Team team = agents.team[agent];
+
+    float distanceToFlag = calculateDistance(agentPos, flags[index(opponentOf(team))]);
+    float distanceToEnemy = nearestEnemyDistances[agent];
+    bool enemyHasFlag = isOpponentCarryingFlag(agent);
+    bool inSide = isOnOwnSide(agent);
+
+    // Check if the agent is in the middle of the field
+    if (isInMiddleOfField(agent)) {
+        agents.middleStuckTime[agent] += elapsedTime;
+    }
+    else {
+        agents.middleStuckTime[agent] = 0;
+    }
+    bool isStuckInMiddle = agents.middleStuckTime[agent] > 5000;
+
+    std::pair<int, int> cell = toCell(agentPos);
+    float threat = getEnemyInfluence(team).sample(cell.first, cell.second);
+
+    bool isCarryingFlag = agents.has(agent, AgentCarryingFlag);
+    bool isTagged = agents.has(agent, AgentTagged);
+    BrainDecision& decision = agents.decision[agent];
+    decision = agents.brains[agent].makeDecision(isCarryingFlag, checkInTeamZone(agent), distanceToFlag, isTagged,
+        enemyHasFlag, distanceToEnemy, threat, agents.has(agent, AgentTagging), isStuckInMiddle, inSide);
+
+    // Prioritize grabbing the flag if the agent is close to it or there are no enemies nearby
+    const BrainParameters& parameters = brainParameters[index(team)];
+    if (!isCarryingFlag && !isTagged && (distanceToFlag <= parameters.grabFlagDistance || distanceToEnemy > parameters.grabEnemyClearance)) {
+        decision = BrainDecision::GrabFlag;
+    }
+
+    // Flag and base routes come from the shared flow fields and chases from the incremental
+    // planner, so exploring is what needs a full search. Pick the target now so the search
+    // can run in the batch. A search that ran out of budget on an earlier tick goes on
+    // toward the same target while the agent walks the partial path it returned.
+    setState(agent, AgentDeliveredPath, false);
+    SuspendedSearch& exploreSearch = agents.exploreSearches[agent];
+    bool explores = decision == BrainDecision::Explore || decision == BrainDecision::AvoidEnemy;
+    if (!explores || (!agents.paths[agent].empty() && !exploreSearch.active)) {
+        return false;
+    }
+
+    FieldPoint& queryTarget = agents.queryTarget[agent];
+    if (!exploreSearch.active) {
+        queryTarget.x = agentRandomBounded(agent, fieldWidth);
+        queryTarget.y = agentRandomBounded(agent, fieldHeight);
+    }
+    std::pair<int, int> startCell = toCell(agentPos);
+    std::pair<int, int> goalCell = toCell(queryTarget);
+    const Pathfinder& pathfinder = teamPathfinders[index(team)];
+    query = PathQuery{ startCell.first, startCell.second, goalCell.first, goalCell.second };
+    query.suspended = &exploreSearch;
+    query.influence = &getEnemyInfluence(team);
+    query.connectivity = pathfinder.getConnectivity();
+    query.heuristic = pathfinder.getHeuristic();
+    return true;
+}
+
+void SimulationCore::update(int agent) {
+    switch (agents.decision[agent]) {
+    case BrainDecision::Explore:
+        exploreField(agent);
+        break;
+    case BrainDecision::GrabFlag:
+        moveTowardsFlag(agent);
+        break;
+    case BrainDecision::CaptureFlag:
+        moveTowardsBase(agent);
+        break;
+    case BrainDecision::AvoidEnemy:
+        exploreField(agent);
+        break;
+    case BrainDecision::RecoverFlag:
+        chaseOpponentWithFlag(agent);
+        break;
+    case BrainDecision::DefendFlag:
+        defendFlag(agent);
+        break;
+    case BrainDecision::TagEnemy:
+        tagEnemy(agent);
+        break;
+    case BrainDecision::ReturnToHomeZone:
+        moveTowardsBase(agent);
+        break;
+    default:
+        exploreField(agent);
+        break;
+    }
+
+    // A path planned for this tick is stale by the next one
+    setState(agent, AgentDeliveredPath, false);
+}
+
+void SimulationCore::moveTowardsFlag(int agent) {
+    double speed = movementSpeed;
+    FieldPoint targetFlagPos = flags[index(opponentOf(agents.team[agent]))];
+    CompactPath& path = agents.paths[agent];
+    std::size_t& currentPathIndex = agents.pathIndex[agent];
+
+    if (path.empty()) {
+        path = planFlowPathTo(agent, targetFlagPos);
+        currentPathIndex = 0;
+    }
+
+    FieldPoint target;
+    if (currentPathIndex < path.size()) {
+        std::pair<int, int> point = path[currentPathIndex];
+        target = { static_cast<double>(point.first), static_cast<double>(point.second) };
+    }
+    else {
+        target = targetFlagPos;
+    }
+
+    FieldPoint agentPos = position(agent);
+    double directionX = target.x - agentPos.x;
+    double directionY = target.y - agentPos.y;
+    double distance = std::sqrt(directionX * directionX + directionY * directionY);
+
+    if (distance > 0) {
+        // Move the agent towards the target
+        double step = std::min(distance, speed);
+        moveTo(agent, { agentPos.x + directionX / distance * step, agentPos.y + directionY / distance * step });
+
+        // Check if the agent has reached the target or a path point
+        if (distance <= speed) {
+            if (!path.empty() && currentPathIndex + 1 < path.size()) {
+                currentPathIndex++; // Set the next point as the current target for the next update
+            }
+            else {
+                path.clear();
+                currentPathIndex = 0;
+            }
+        }
+    }
+    else {
+        // The agent has reached the flag or the next point in the path
+        if (!path.empty() && currentPathIndex + 1 < path.size()) {
+            currentPathIndex++;
+        }
+    }
+
+    // Check if the agent has reached the enemy flag
+    if (position(agent) == targetFlagPos) {
+        effects[agent].reachedFlag = true;
+    }
+}
+
+void SimulationCore::moveTowardsBase(int agent) {
+    double speed = movementSpeed;
+    Team team = agents.team[agent];
+    FieldPoint targetBasePos = bases[index(team)];
+    CompactPath& path = agents.paths[agent];
+    std::size_t& currentPathIndex = agents.pathIndex[agent];
+
+    // Check if a new path needs to be calculated
+    if (path.empty()) {
+        bool isAvoiding = false;
+        if (!agents.has(agent, AgentTagged)) {
+            // If the agent is not tagged, avoid enemies while moving towards the base
+            FieldPoint agentPos = position(agent);
+            double awayX = 0.0;
+            double awayY = 0.0;
+            float distanceToEnemy = distanceToNearestEnemy(agent);
+            if (distanceToEnemy <= brainParameters[index(team)].tagProximityThreshold) {
+                // If an enemy is nearby, calculate a direction away from the nearest enemy
+                const PointSet& enemies = snapshot.members[index(opponentOf(team))];
+                float squaredDistance;
+                int nearest = findNearestPoint(static_cast<float>(agentPos.x), static_cast<float>(agentPos.y), enemies.x.data(),
+                    enemies.y.data(), enemies.size(), std::numeric_limits<float>::infinity(), squaredDistance);
+                if (nearest != -1) {
+                    FieldPoint enemyPosition{ enemies.x[nearest], enemies.y[nearest] };
+                    float distance = calculateDistance(agentPos, enemyPosition);
+                    if (distance < distanceToEnemy) {
+                        awayX = agentPos.x - enemyPosition.x;
+                        awayY = agentPos.y - enemyPosition.y;
+                    }
+                }
+
+                double distance = std::sqrt(awayX * awayX + awayY * awayY);
+                if (distance > 0) {
+                    awayX /= distance;
+                    awayY /= distance;
+                }
+                const float avoidanceDistance = 150.0f;
+                targetBasePos = { agentPos.x + awayX * avoidanceDistance, agentPos.y + awayY * avoidanceDistance };
+                isAvoiding = true;
+            }
+        }
+        // The avoidance point is a one-off target, only the base itself has a shared field
+        path = isAvoiding ? planPathTo(agent, targetBasePos) : planFlowPathTo(agent, targetBasePos);
+        currentPathIndex = 0;
+    }
+
+    // Only proceed if there is a path
+    if (!path.empty()) {
+        // Set the next waypoint in the path as the target
+        std::pair<int, int> point = path[currentPathIndex];
+        FieldPoint agentPos = position(agent);
+        double directionX = point.first - agentPos.x;
+        double directionY = point.second - agentPos.y;
+        double distance = std::sqrt(directionX * directionX + directionY * directionY);
+
+        // Move the agent towards the target
+        if (distance > 0) {
+            double step = std::min(distance, speed);
+            moveTo(agent, { agentPos.x + directionX / distance * step, agentPos.y + directionY / distance * step });
+        }
+
+        // Check if the agent has reached the current target or the path point
+        if (distance <= speed) {
+            currentPathIndex++;
+
+            if (currentPathIndex >= path.size() && agents.has(agent, AgentPathPartial)) {
+                // Only the first part of a long route was refined, query the rest next tick
+                path.clear();
+                currentPathIndex = 0;
+            }
+            // Check if the agent has reached the end of the path (base position)
+            else if (currentPathIndex >= path.size()) {
+                if (agents.has(agent, AgentTagged) || checkInTeamZone(agent)) {
+                    // If the agent is tagged or in its team zone, reset the tagged status
+                    setState(agent, AgentTagged, false);
+                }
+
+                if (agents.has(agent, AgentCarryingFlag) && !agents.has(agent, AgentTagged)) {
+                    setState(agent, AgentCarryingFlag, false); // The agent reaches the base and drops the flag
+                    effects[agent].returnedFlag = true;
+                    effects[agent].scored = true;
+                }
+                else {
+                    setState(agent, AgentCarryingFlag, false); // Tagged on the way, the flag is dropped without scoring
+                }
+
+                path.clear();
+                currentPathIndex = 0;
+
+                // Determine the next action for the agent
+                if (agents.has(agent, AgentTagged)) {
+                    exploreField(agent);
+                }
+                else if (agentRandomUnit(agent) < 0.5) {
+                    exploreField(agent);
+                }
+                else {
+                    moveTowardsFlag(agent);
+                }
+            }
+        }
+    }
+    else {
+        // The agent is already at the base, drop the flag and reset the tagged status
+        if (agents.has(agent, AgentCarryingFlag) && !agents.has(agent, AgentTagged)) {
+            setState(agent, AgentCarryingFlag, false);
+            effects[agent].returnedFlag = true;
+        }
+
+        if (checkInTeamZone(agent)) {
+            setState(agent, AgentTagged, false);
+        }
+
+        // Determine the next action for the agent
+        if (agents.has(agent, AgentTagged)) {
+            exploreField(agent);
+        }
+        else if (agentRandomUnit(agent) < 0.5) {
+            exploreField(agent);
+        }
+        else {
+            moveTowardsFlag(agent);
+        }
+    }
+}
+
+void SimulationCore::exploreField(int agent) {
+    double speed = movementSpeed;
+    CompactPath& path = agents.paths[agent];
+    std::size_t& currentPathIndex = agents.pathIndex[agent];
+
+    // Generate a random target position within the game field, unless the decision phase
+    // already picked one and had the path to it planned
+    FieldPoint explorationTarget;
+    bool hasDeliveredPath = agents.has(agent, AgentDeliveredPath);
+    if (hasDeliveredPath) {
+        explorationTarget = agents.queryTarget[agent];
+    }
+    else {
+        explorationTarget.x = agentRandomBounded(agent, fieldWidth);
+        explorationTarget.y = agentRandomBounded(agent, fieldHeight);
+    }
+
+    // Check if a new path needs to be calculated, or the next slice of a budgeted one arrived
+    if (path.empty() || hasDeliveredPath) {
+        path = planPathTo(agent, explorationTarget);
+        currentPathIndex = 0;
+    }
+
+    // Only proceed if there is a path
+    if (!path.empty()) {
+        // Set the next waypoint in the path as the target
+        std::pair<int, int> point = path[currentPathIndex];
+        FieldPoint agentPos = position(agent);
+        double directionX = point.first - agentPos.x;
+        double directionY = point.second - agentPos.y;
+        double distance = std::sqrt(directionX * directionX + directionY * directionY);
+
+        // Move the agent towards the target
+        if (distance > 0) {
+            double step = std::min(distance, speed);
+            moveTo(agent, { agentPos.x + directionX / distance * step, agentPos.y + directionY / distance * step });
+        }
+
+        // Check if the agent has reached the current target or the path point
+        if (distance <= speed) {
+            currentPathIndex++;
+
+            if (currentPathIndex >= path.size() && agents.has(agent, AgentPathPartial)) {
+                // Only the first part of a long route was refined, query the rest next tick
+                path.clear();
+                currentPathIndex = 0;
+            }
+            // Check if the agent has reached the end of the path (exploration target)
+            else if (currentPathIndex >= path.size()) {
+                // Check if the agent is close to the flag or if there are no enemies nearby
+                float distanceToFlag = calculateDistance(position(agent), flags[index(opponentOf(agents.team[agent]))]);
+                float distanceToEnemy = distanceToNearestEnemy(agent);
+
+                const BrainParameters& parameters = brainParameters[index(agents.team[agent])];
+                if (distanceToFlag <= parameters.proximityThreshold || distanceToEnemy > parameters.tagProximityThreshold) {
+                    // Cancel exploration and move towards the flag
+                    path.clear();
+                    currentPathIndex = 0;
+                    moveTowardsFlag(agent);
+                    return;
+                }
+
+                // Reached the exploration target, generate a new random target
+                path.clear();
+                currentPathIndex = 0;
+                exploreField(agent);
+            }
+        }
+    }
+}
+
+void SimulationCore::tagEnemy(int agent) {
+    double speed = movementSpeed;
+    // The perception pass found it from where the agent stood before moving
+    int closestEnemy = tagTargets[agent];
+
+    if (closestEnemy == -1) {
+        return;
+    }
+
+    // Check if the agent is allowed to tag (cooldown period has elapsed)
+    std::int64_t currentTime = clock;
+    if (currentTime - agents.lastTagTime[agent] < tagCooldownPeriod) {
+        setState(agent, AgentTagging, false);
+
+        // Still cooling down, move towards the flag or home instead
+        if (agents.has(agent, AgentCarryingFlag)) {
+            moveTowardsBase(agent);
+        }
+        else {
+            moveTowardsFlag(agent);
+        }
+        return;
+    }
+
+    setState(agent, AgentTagging, true);
+
+    // Replan every tick, the planner only repairs what changed since the last one
+    CompactPath& path = agents.paths[agent];
+    std::size_t& currentPathIndex = agents.pathIndex[agent];
+    path = planChasePathTo(agent, snapshot.position(closestEnemy));
+    currentPathIndex = path.size() > 1 ? 1 : 0;
+
+    FieldPoint target;
+    if (currentPathIndex < path.size()) {
+        std::pair<int, int> point = path[currentPathIndex];
+        target = { static_cast<double>(point.first), static_cast<double>(point.second) };
+    }
+    else {
+        target = snapshot.position(closestEnemy);
+    }
+
+    FieldPoint agentPos = position(agent);
+    double directionX = target.x - agentPos.x;
+    double directionY = target.y - agentPos.y;
+    double distance = std::sqrt(directionX * directionX + directionY * directionY);
+
+    if (distance > 0) {
+        // Move the agent towards the target
+        double step = std::min(distance, speed);
+        moveTo(agent, { agentPos.x + directionX / distance * step, agentPos.y + directionY / distance * step });
+
+        // Within tag range the carried flag goes back before the tag
+        if (distance <= brainParameters[index(agents.team[agent])].tagProximityThreshold && agents.has(agent, AgentCarryingFlag)) {
+            setState(agent, AgentCarryingFlag, false);
+            effects[agent].returnedFlag = true;
+        }
+        effects[agent].taggedEnemy = closestEnemy;
+        agents.lastTagTime[agent] = currentTime;
+        setState(agent, AgentTagging, false);
+
+        // Move towards the flag or home after tagging the enemy
+        if (agents.has(agent, AgentCarryingFlag)) {
+            moveTowardsBase(agent);
+        }
+        else {
+            moveTowardsFlag(agent);
+        }
+    }
+    else {
+        // Standing on the enemy already, nothing to tag with a zero-length chase
+        if (agents.has(agent, AgentCarryingFlag)) {
+            moveTowardsBase(agent);
+        }
+        else {
+            moveTowardsFlag(agent);
+        }
+    }
+}
+
+void SimulationCore::chaseOpponentWithFlag(int agent) {
+    double speed = movementSpeed;
+
+    // If an opponent has the team's flag, move towards them
+    int carrier = snapshot.flagCarrier[index(agents.team[agent])];
+    if (carrier == -1) {
+        return;
+    }
+
+    FieldPoint opponent = snapshot.position(carrier);
+    CompactPath& path = agents.paths[agent];
+    std::size_t& currentPathIndex = agents.pathIndex[agent];
+
+    // Replan every tick, the planner only repairs what changed since the last one
+    path = planChasePathTo(agent, opponent);
+    currentPathIndex = path.size() > 1 ? 1 : 0;
+
+    FieldPoint target;
+    if (currentPathIndex < path.size()) {
+        std::pair<int, int> point = path[currentPathIndex];
+        target = { static_cast<double>(point.first), static_cast<double>(point.second) };
+    }
+    else {
+        target = opponent;
+    }
+
+    FieldPoint agentPos = position(agent);
+    double directionX = target.x - agentPos.x;
+    double directionY = target.y - agentPos.y;
+    double distance = std::sqrt(directionX * directionX + directionY * directionY);
+
+    if (distance > 0) {
+        // Move the agent towards the target
+        double step = std::min(distance, speed);
+        moveTo(agent, { agentPos.x + directionX / distance * step, agentPos.y + directionY / distance * step });
+
+        // Check if the agent has reached the target or a path point
+        if (!path.empty() && currentPathIndex + 1 < path.size()) {
+            currentPathIndex++;
+        }
+        else {
+            path.clear();
+            currentPathIndex = 0;
+        }
+    }
+    else {
+        // The agent has reached the opponent with the flag
+        path.clear();
+        currentPathIndex = 0;
+    }
+}
+
+float SimulationCore::distanceToNearestEnemy(int agent) const {
+    // The other team's agents where they stood as the tick began
+    const PointSet& enemies = snapshot.members[index(opponentOf(agents.team[agent]))];
+    float squaredDistance;
+    int nearest = findNearestPoint(static_cast<float>(agents.x[agent]), static_cast<float>(agents.y[agent]), enemies.x.data(),
+        enemies.y.data(), enemies.size(), std::numeric_limits<float>::infinity(), squaredDistance);
+    return nearest != -1 ? std::sqrt(squaredDistance) : std::numeric_limits<float>::max();
+}
+
+void SimulationCore::defendFlag(int agent) {
+    double speed = movementSpeed;
+    int closestEnemy = tagTargets[agent];
+    CompactPath& path = agents.paths[agent];
+    std::size_t& currentPathIndex = agents.pathIndex[agent];
+
+    if (closestEnemy == -1) {
+        setState(agent, AgentTagging, false);
+
+        // With no enemy nearby, wander off or head for the flag
+        if (distanceToNearestEnemy(agent) > brainParameters[index(agents.team[agent])].tagProximityThreshold) {
+            path.clear();
+            currentPathIndex = 0;
+            if (agentRandomUnit(agent) < 0.5) {
+                FieldPoint explorationTarget;
+                explorationTarget.x = agentRandomBounded(agent, fieldWidth);
+                explorationTarget.y = agentRandomBounded(agent, fieldHeight);
+                path = planPathTo(agent, explorationTarget);
+            }
+            else {
+                path = planFlowPathTo(agent, flags[index(opponentOf(agents.team[agent]))]);
+            }
+        }
+        return;
+    }
+
+    // Check if the agent is allowed to tag (cooldown period has elapsed)
+    std::int64_t currentTime = clock;
+    if (currentTime - agents.lastTagTime[agent] < tagCooldownPeriod) {
+        return;
+    }
+
+    setState(agent, AgentTagging, true);
+
+    if (path.empty()) {
+        path = planPathTo(agent, snapshot.position(closestEnemy));
+        currentPathIndex = 0;
+    }
+
+    FieldPoint target;
+    if (currentPathIndex < path.size()) {
+        std::pair<int, int> point = path[currentPathIndex];
+        target = { static_cast<double>(point.first), static_cast<double>(point.second) };
+    }
+    else {
+        target = snapshot.position(closestEnemy);
+    }
+
+    FieldPoint agentPos = position(agent);
+    double directionX = target.x - agentPos.x;
+    double directionY = target.y - agentPos.y;
+    double distance = std::sqrt(directionX * directionX + directionY * directionY);
+
+    // After a tag the agent carries on along its path, or wanders off once it has run out
+    auto afterTag = [&]() {
+        if (currentPathIndex + 1 < path.size()) {
+            currentPathIndex++;
+        }
+        else {
+            path.clear();
+            currentPathIndex = 0;
+            FieldPoint explorationTarget;
+            explorationTarget.x = agentRandomBounded(agent, fieldWidth);
+            explorationTarget.y = agentRandomBounded(agent, fieldHeight);
+            path = planPathTo(agent, explorationTarget);
+        }
+        setState(agent, AgentTagging, false);
+        };
+
+    if (distance > 0) {
+        // Move the agent towards the target
+        double step = std::min(distance, speed);
+        moveTo(agent, { agentPos.x + directionX / distance * step, agentPos.y + directionY / distance * step });
+
+        // Check if the agent has reached the target or a path point
+        if (distance <= speed) {
+            if (!path.empty() && currentPathIndex + 1 < path.size()) {
+                currentPathIndex++;
+            }
+            else {
+                effects[agent].taggedEnemy = closestEnemy;
+                agents.lastTagTime[agent] = currentTime;
+                afterTag();
+            }
+        }
+    }
+    else {
+        // The agent has reached the enemy
+        effects[agent].taggedEnemy = closestEnemy;
+        agents.lastTagTime[agent] = currentTime;
+        afterTag();
+    }
+}
+
+CompactPath SimulationCore::planPathTo(int agent, const FieldPoint& target) {
+    if (agents.has(agent, AgentDeliveredPath) && target == agents.queryTarget[agent]) {
+        setState(agent, AgentDeliveredPath, false);
+        setState(agent, AgentPathPartial, agents.deliveredPaths[agent].partial);
+        return toWorldPath(agents.deliveredPaths[agent].path);
+    }
+
+    // Obstacles come from the occupancy grid rebuilt once per step. The search runs on a copy
+    // of the team's settings, the last path's state is the caller's own.
+    Pathfinder pathfinder = teamPathfinders[index(agents.team[agent])];
+    std::pair<int, int> start = toCell(position(agent));
+    std::pair<int, int> goal = toCell(target);
+    std::vector<std::pair<int, int>> newPath = pathfinder.findPath(start.first, start.second, goal.first, goal.second, occupancyGrid);
+    setState(agent, AgentPathPartial, pathfinder.isLastPathPartial());
+    return toWorldPath(newPath);
+}
+
+CompactPath SimulationCore::planFlowPathTo(int agent, const FieldPoint& goal) {
+    // Flags and bases are goals every agent keeps returning to, so read the route off the
+    // shared flow field toward them instead of searching for it
+    std::pair<int, int> goalCell = toCell(goal);
+    const FlowField* field = flowFields.getField(goalCell.first, goalCell.second);
+    if (field == nullptr) {
+        return planPathTo(agent, goal);
+    }
+
+    setState(agent, AgentPathPartial, false);
+    std::pair<int, int> start = toCell(position(agent));
+
+    // The last cell holds the flag or zone centre, so finish on its exact pixel rather than
+    // on the cell centre
+    return toWorldPath(field->tracePath(start.first, start.second), &goal);
+}
+
+CompactPath SimulationCore::planChasePathTo(int agent, const FieldPoint& target) {
+    // Chases replan every tick toward a moving target, so they keep their search tree between
+    // ticks instead of searching from scratch
+    std::pair<int, int> start = toCell(position(agent));
+    std::pair<int, int> goal = toCell(target);
+    std::vector<std::pair<int, int>> newPath = agents.chasePlanners[agent]->findPath(start.first, start.second, goal.first, goal.second,
+        occupancyGrid);
+    setState(agent, AgentPathPartial, false);
+    return toWorldPath(newPath);
+}
+
+std::pair<int, int> SimulationCore::toCell(const FieldPoint& point) const {
+    int x = static_cast<int>(std::floor(point.x / pathCellSize));
+    int y = static_cast<int>(std::floor(point.y / pathCellSize));
+    return { std::clamp(x, 0, occupancyGrid.getWidth() - 1), std::clamp(y, 0, occupancyGrid.getHeight() - 1) };
+}
+
+CompactPath SimulationCore::toWorldPath(const std::vector<std::pair<int, int>>& cellPath, const FieldPoint* exactEnd) const {
+    // Only the corners of the staircase are kept, and the agent walks straight between them
+    // one cell length per waypoint, the pace it had along every cell of the staircase.
+    // Corners sit on cell centres, which at one-pixel cells are the cells themselves.
+    std::vector<std::pair<int, int>> corners = CompactPath::findCorners(cellPath, occupancyGrid);
+    for (auto& corner : corners) {
+        corner = { corner.first * pathCellSize + pathCellSize / 2, corner.second * pathCellSize + pathCellSize / 2 };
+    }
+    if (exactEnd != nullptr && !corners.empty()) {
+        corners.back() = { static_cast<int>(exactEnd->x), static_cast<int>(exactEnd->y) };
+    }
+    return CompactPath(corners, pathCellSize);
+}
+
+bool SimulationCore::checkInTeamZone(int agent) const {
+    // A team's zone is a circular area around its own flag
+    const float zoneRadius = 40.0f;
+    return calculateDistance(position(agent), flags[index(agents.team[agent])]) <= zoneRadius;
+}
+
+bool SimulationCore::isOnOwnSide(int agent) const {
+    // Blue owns the left half of the field and red the right half
+    return agents.team[agent] == Team::Blue ? agents.x[agent] < fieldWidth / 2 : agents.x[agent] >= fieldWidth / 2;
+}
+
+bool SimulationCore::isOpponentCarryingFlag(int agent) const {
+    return snapshot.flagCarrier[index(agents.team[agent])] != -1;
+}
+
+bool SimulationCore::isInMiddleOfField(int agent) const {
+    FieldPoint fieldCenter{ static_cast<double>(fieldWidth / 2), static_cast<double>(fieldHeight / 2) };
+    return calculateDistance(position(agent), fieldCenter) < 100.0f;
+}
+
+void SimulationCore::settleFlags() {
+    for (FlagStatus& flag : flagStatus) {
+        if (flag.carrier != -1 && !agents.has(flag.carrier, AgentCarryingFlag)) {
+            flag.state = effects[flag.carrier].returnedFlag ? FlagState::AtBase : FlagState::Dropped;
+            flag.carrier = -1;
+        }
+    }
+}
+
+void SimulationCore::commitEffects(int agent) {
+    const AgentEffects& effect = effects[agent];
+    if (effect.taggedEnemy != -1) {
+        setState(effect.taggedEnemy, AgentTagged, true);
+    }
+    if (effect.scored) {
+        incrementScore(agent);
+    }
+
+    // Of teammates reaching the flag on the same tick the first in update order takes it
+    if (effect.reachedFlag) {
+        pickUpFlag(agent);
+    }
+}
+
+void SimulationCore::pickUpFlag(int agent) {
+    // Only one agent of a team carries the flag at a time
+    FlagStatus& flag = flagStatus[index(opponentOf(agents.team[agent]))];
+    if (flag.state == FlagState::Carried) {
+        return;
+    }
+    flag.state = FlagState::Carried;
+    flag.carrier = agent;
+    setState(agent, AgentCarryingFlag, true);
+}
+
+void SimulationCore::incrementScore(int agent) {
+    ++scores[index(agents.team[agent])];
+}
+
+int SimulationCore::randomBounded(int bound) {
+    // Scaled rather than drawn through a standard distribution, whose output differs between
+    // standard libraries
+    return static_cast<int>((static_cast<std::uint64_t>(random()) * static_cast<std::uint64_t>(bound)) >> 32);
+}
+
+std::uint32_t SimulationCore::nextAgentRandom(int agent) {
+    // SplitMix64, whose whole state is one word per agent
+    std::uint64_t z = (agents.randomState[agent] += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+int SimulationCore::agentRandomBounded(int agent, int bound) {
+    return static_cast<int>((static_cast<std::uint64_t>(nextAgentRandom(agent)) * static_cast<std::uint64_t>(bound)) >> 32);
+}
+
+double SimulationCore::agentRandomUnit(int agent) {
+    return nextAgentRandom(agent) * (1.0 / 4294967296.0);
+}
+
+std::uint64_t SimulationCore::computeStateHash() const {
+    std::uint64_t hash = fnvOffsetBasis;
+    hashValue(hash, clock);
+    for (int team = 0; team < 2; ++team) {
+        hashValue(hash, flags[team].x);
+        hashValue(hash, flags[team].y);
+        hashValue(hash, bases[team].x);
+        hashValue(hash, bases[team].y);
+        hashValue(hash, flagStatus[team].state);
+        hashValue(hash, flagStatus[team].carrier);
+        hashValue(hash, scores[team]);
+    }
+    for (int agent = 0; agent < agents.size(); ++agent) {
+        hashValue(hash, agents.x[agent]);
+        hashValue(hash, agents.y[agent]);
+        hashValue(hash, agents.team[agent]);
+        hashValue(hash, agents.state[agent]);
+        hashValue(hash, agents.decision[agent]);
+        // 32 bits on every platform, so hashes agree between 32- and 64-bit builds
+        hashValue(hash, static_cast<std::uint32_t>(agents.pathIndex[agent]));
+        hashValue(hash, agents.middleStuckTime[agent]);
+        hashValue(hash, agents.lastTagTime[agent]);
+        hashValue(hash, agents.randomState[agent]);
+        for (const auto& corner : agents.paths[agent].getCorners()) {
+            hashValue(hash, corner);
+        }
+    }
+    return hash;
+}
@@ -0,0 +1,324 @@
+#ifndef SIMULATIONCORE_H
+#define SIMULATIONCORE_H
+
+#include "Pathfinder.h"
+#include "OccupancyGrid.h"
+#include "HierarchicalPathfinder.h"
+#include "FlowField.h"
+#include "LandmarkTable.h"
+#include "InfluenceMap.h"
+#include "PathCache.h"
+#include "ThreadPool.h"
+#include "IncrementalPlanner.h"
+#include "CompactPath.h"
+#include "Brain.h"
+#include "SpatialHash.h"
+#include <array>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <random>
+#include <cstdint>
+
+enum class Team : std::uint8_t {
+    Blue,
+    Red
+};
+
+// Point on the field in pixels
+struct FieldPoint {
+    double x;
+    double y;
+
+    bool operator==(const FieldPoint& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const FieldPoint& other) const { return !(*this == other); }
+};
+
+// Bits of AgentTable::state
+enum AgentStateBit : std::uint8_t {
+    AgentTagged = 1,
+    AgentTagging = 2,
+    AgentCarryingFlag = 4,
+    AgentPathPartial = 8,    // the path stops short of its goal, query again at its end
+    AgentDeliveredPath = 16, // the batch solved this tick's query, planPathTo hands it out
+    AgentDisabled = 32       // stands still, but still blocks cells and can be tagged
+};
+
+// State of every agent, one entry per agent in each array. An agent is its index, which
+// is also the handle of its path in paths. The fields every tick reads for every agent come
+// first and are kept apart from the bulky planning state behind them.
+struct AgentTable {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<Team> team;
+    std::vector<std::uint8_t> state;
+    std::vector<BrainDecision> decision;
+    std::vector<std::size_t> pathIndex;
+    std::vector<CompactPath> paths;
+    std::vector<int> middleStuckTime;
+    std::vector<std::int64_t> lastTagTime;
+    std::vector<std::uint64_t> randomState; // each agent draws from its own stream
+    std::vector<FieldPoint> queryTarget;
+    std::vector<SuspendedSearch> exploreSearches;
+    std::vector<PathResult> deliveredPaths;
+    std::vector<Brain> brains;
+    std::vector<std::unique_ptr<IncrementalPlanner>> chasePlanners;
+
+    int size() const { return static_cast<int>(x.size()); }
+    bool has(int agent, std::uint8_t bit) const { return (state[agent] & bit) != 0; }
+};
+
+// Where a team's flag is. It starts at its stand; an agent of the other team that reaches
+// the stand picks it up and carries it until it either brings it home, which puts it back
+// on its stand, or lets go of it on the way, which leaves it dropped. A dropped flag stays
+// off the field until it is picked up from its stand again.
+enum class FlagState : std::uint8_t {
+    AtBase,
+    Carried,
+    Dropped
+};
+
+struct FlagStatus {
+    FlagState state = FlagState::AtBase;
+    int carrier = -1; // the agent carrying the flag, -1 unless carried
+};
+
+// Points as separate coordinate arrays for the proximity kernels, each with the id of what
+// it stands for
+struct PointSet {
+    std::vector<int> ids;
+    std::vector<float> x;
+    std::vector<float> y;
+
+    void clear() {
+        ids.clear();
+        x.clear();
+        y.clear();
+    }
+    void add(int id, float pointX, float pointY) {
+        ids.push_back(id);
+        x.push_back(pointX);
+        y.push_back(pointY);
+    }
+    int size() const { return static_cast<int>(ids.size()); }
+};
+
+// The world as a tick began, which is all the agents see of each other during it. Per agent
+// its position, team and state bits, kept as floats and bytes so a pass over everyone reads
+// little memory; per team its agents as a point set in index order, and the agent carrying
+// the team's flag or -1.
+struct WorldSnapshot {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<Team> team;
+    std::vector<std::uint8_t> state;
+    std::array<PointSet, 2> members;
+    std::array<int, 2> flagCarrier{ { -1, -1 } };
+
+    int size() const { return static_cast<int>(x.size()); }
+    bool has(int agent, std::uint8_t bit) const { return (state[agent] & bit) != 0; }
+    FieldPoint position(int agent) const { return { x[agent], y[agent] }; }
+};
+
+// The game without any Qt: agents, flags, bases and scores, plus the shared pathfinding
+// state every agent plans against. step advances it by one tick; a renderer reads the agent
+// table and the flag and score state in between and never writes to them.
+//
+// Every random choice comes from the core's own generator, or from the agent's own stream
+// seeded from it, and every timer runs on the tick clock, which only step advances. With an
+// expansion budget set for the batched searches, two cores built with the same seed and
+// driven through the same calls play bit-identical games on any number of threads, which
+// getStateHash tells apart tick by tick.
+class SimulationCore {
+public:
+    // pathCellSize is the side of a pathfinding cell in pixels. Grid memory and search cost
+    // drop with its square, at the price of coarser paths.
+    // workerThreads counts the calling thread, 0 picks one per hardware core.
+    SimulationCore(int fieldWidth, int fieldHeight, int pathCellSize = 1, std::uint32_t seed = 1, unsigned workerThreads = 0);
+
+    // Moving a flag or base rebuilds the landmark tables on the next step
+    void setFlagPosition(Team team, const FieldPoint& position);
+    void setBasePosition(Team team, const FieldPoint& position);
+    const FieldPoint& getFlagPosition(Team team) const { return flags[index(team)]; }
+    const FieldPoint& getBasePosition(Team team) const { return bases[index(team)]; }
+
+    int addAgent(Team team, const FieldPoint& position);
+    // Thresholds the team's agents decide and move by, for those on the field and those added
+    // later. The proximity thresholds also steer the movement rules, such as when an agent
+    // heading home swerves away from an enemy.
+    void setBrainParameters(Team team, const BrainParameters& parameters);
+    const BrainParameters& getBrainParameters(Team team) const { return brainParameters[index(team)]; }
+    void clearAgents();
+    void setAgentEnabled(int agent, bool enabled);
+
+    // Advances the tick clock, decides for every agent, runs the searches that needs as one
+    // batch, then updates every agent. Agents perceive each other as they were when the tick
+    // began, so deciding and updating run across the worker threads. Each update only moves
+    // and changes its own agent; tags, flag pickups and returns and scores are committed
+    // afterwards one agent at a time, blue agents first.
+    void step(int elapsedMilliseconds);
+
+    // Milliseconds of game time the steps so far added up to
+    std::int64_t getClock() const { return clock; }
+
+    // FNV-1a hash of the state the next tick starts from: the clock, flags, bases, scores and
+    // every agent's position, state, decision and path. Updated by every step.
+    std::uint64_t getStateHash() const { return stateHash; }
+
+    // Uniform in [0, bound), from the core's generator, for callers that place agents. Agents
+    // added later get their streams from it as well.
+    int randomBounded(int bound);
+
+    const AgentTable& getAgents() const { return agents; }
+
+    // The world as the last step began, what the agents decided and moved on
+    const WorldSnapshot& getSnapshot() const { return snapshot; }
+    int getScore(Team team) const { return scores[index(team)]; }
+    void resetScores() { scores = { 0, 0 }; }
+
+    // Kept up to date by the commits of every step, so none of these look at the agents
+    const FlagStatus& getFlagStatus(Team team) const { return flagStatus[index(team)]; }
+    // A team's flag is hidden while it is away from its stand
+    bool isFlagHidden(Team team) const { return flagStatus[index(team)].state != FlagState::AtBase; }
+    bool isFlagCaptured(Team team) const { return flagStatus[index(team)].state == FlagState::Carried; }
+
+    int getFieldWidth() const { return fieldWidth; }
+    int getFieldHeight() const { return fieldHeight; }
+    int getPathCellSize() const { return pathCellSize; }
+    const OccupancyGrid& getOccupancyGrid() const { return occupancyGrid; }
+    HierarchicalPathfinder& getHierarchy() { return hierarchy; }
+    FlowFieldService& getFlowFields() { return flowFields; }
+    const LandmarkTable& getLandmarks() const { return landmarks; }
+    PathCache& getPathCache() { return pathCache; }
+
+    // Threat the other team spreads over the field this tick, in path cells
+    const InfluenceMap& getEnemyInfluence(Team team) const {
+        return team == Team::Blue ? threatToBlue : threatToRed;
+    }
+
+    // Extra step cost of a cell per unit of threat on it. A lone enemy reads 1 at its cell.
+    double getThreatWeight() const { return threatWeight; }
+
+    // Wall-clock time per tick the batched path searches may take together, split across the
+    // agents that replan. Searches that run out continue on the next tick.
+    void setFrameSearchBudget(std::int64_t microseconds) { frameSearchBudget = microseconds; }
+    std::int64_t getFrameSearchBudget() const { return frameSearchBudget; }
+
+    // Node expansions per tick for the batched searches, split evenly across the agents that
+    // replan. When set it replaces the time budget, and the batch leaves out the path cache,
+    // whose contents would otherwise depend on which worker thread stored first. 0 goes back
+    // to the time budget.
+    void setFrameExpansionBudget(std::size_t expansions) { frameExpansionBudget = expansions; }
+    std::size_t getFrameExpansionBudget() const { return frameExpansionBudget; }
+    bool isDeterministic() const { return frameExpansionBudget != 0; }
+
+private:
+    using Positions = std::vector<std::pair<int, int>>;
+
+    // What an agent's update does to other agents and to the flags, held back until the
+    // updates of the tick are done
+    struct AgentEffects {
+        int taggedEnemy = -1;
+        bool returnedFlag = false;
+        bool scored = false;
+        bool reachedFlag = false;
+    };
+
+    static int index(Team team) { return static_cast<int>(team); }
+    static Team opponentOf(Team team) { return team == Team::Blue ? Team::Red : Team::Blue; }
+
+    FieldPoint position(int agent) const { return { agents.x[agent], agents.y[agent] }; }
+    void moveTo(int agent, const FieldPoint& point);
+    void setState(int agent, std::uint8_t bit, bool value);
+    void placeLandmarks();
+    void takeSnapshot();
+    // Finds for every observer the closest of the points at most maxSquaredDistance away, into
+    // the nearest and squared distance scratch, scanning every point for small batches and
+    // going through the spatial hash for large ones
+    void findNearestInBatch(const PointSet& observers, const PointSet& points, float maxSquaredDistance);
+
+    // Decision phase: picks this tick's behaviour before anyone moves and returns true with
+    // the query to run when that behaviour is going to need a fresh path
+    bool decide(int agent, int elapsedTime, PathQuery& query);
+    void update(int agent);
+
+    void moveTowardsFlag(int agent);
+    void moveTowardsBase(int agent);
+    void exploreField(int agent);
+    void chaseOpponentWithFlag(int agent);
+    void defendFlag(int agent);
+    void tagEnemy(int agent);
+
+    // From where the agent stands now, unlike the perception pass at the start of the tick
+    float distanceToNearestEnemy(int agent) const;
+    bool checkInTeamZone(int agent) const;
+    bool isOnOwnSide(int agent) const;
+    bool isOpponentCarryingFlag(int agent) const;
+    bool isInMiddleOfField(int agent) const;
+    // Moves the flags whose carriers let go of them during the updates to their stand or
+    // to dropped, before any commit can pick them up again
+    void settleFlags();
+    void commitEffects(int agent);
+    void pickUpFlag(int agent);
+    void incrementScore(int agent);
+
+    CompactPath planPathTo(int agent, const FieldPoint& target);
+    CompactPath planFlowPathTo(int agent, const FieldPoint& goal);
+    CompactPath planChasePathTo(int agent, const FieldPoint& target);
+
+    // Mapping between field pixels and the path cells of the shared grid
+    std::pair<int, int> toCell(const FieldPoint& point) const;
+    // Paths are smoothed to their corners on the way, and exactEnd, when given, replaces the
+    // centre of the last cell
+    CompactPath toWorldPath(const std::vector<std::pair<int, int>>& cellPath, const FieldPoint* exactEnd = nullptr) const;
+
+    std::uint32_t nextAgentRandom(int agent);
+    int agentRandomBounded(int agent, int bound);
+    double agentRandomUnit(int agent);
+    std::uint64_t computeStateHash() const;
+
+    int fieldWidth;
+    int fieldHeight;
+    int pathCellSize;
+    double movementSpeed;
+    float tagRange;
+    std::int64_t tagCooldownPeriod;
+    std::array<FieldPoint, 2> flags;
+    std::array<FieldPoint, 2> bases;
+    std::array<FlagStatus, 2> flagStatus;
+    std::array<BrainParameters, 2> brainParameters;
+    std::array<int, 2> scores;
+    AgentTable agents;
+
+    OccupancyGrid occupancyGrid;
+    HierarchicalPathfinder hierarchy;
+    FlowFieldService flowFields;
+    LandmarkTable landmarks;
+    InfluenceMap threatToBlue;
+    InfluenceMap threatToRed;
+    double threatWeight;
+
+    // The world as this tick began, and per team the agents of the other team it could tag
+    WorldSnapshot snapshot;
+    std::array<PointSet, 2> taggableBy;
+
+    // What the perception pass found per agent: how far the nearest enemy is, and the
+    // closest enemy the agent can tag, or -1
+    std::vector<float> nearestEnemyDistances;
+    std::vector<int> tagTargets;
+    std::vector<int> nearestScratch;
+    std::vector<float> squaredDistanceScratch;
+    SpatialHash perceptionHash;
+    std::vector<AgentEffects> effects;
+    PathCache pathCache;
+    std::vector<Pathfinder> teamPathfinders;
+    Pathfinder batchPathfinder;
+    ThreadPool workers;
+    std::int64_t frameSearchBudget;
+    std::size_t frameExpansionBudget;
+    std::int64_t clock;
+    std::uint64_t stateHash;
+    std::mt19937 random;
+};
+
+#endif
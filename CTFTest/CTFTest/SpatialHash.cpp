@@ -0,0 +1,204 @@
+#include "SpatialHash.h"
+#include "ProximityKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // Float squared distances can come out a little short, so the distance bounds that end a
+    // search are shrunk by this fraction to never skip a point that counts
+    const float boundSlack = 1e-3f;
+
+    // Cells with at least this many points, such as where agents stand on top of each other,
+    // are scanned with the vector kernels
+    const int crowdedCell = 16;
+
+    // Calls visit(cell) for every cell whose Chebyshev distance in cells from the centre is
+    // exactly ring, clipped to the grid
+    template <typename Visit>
+    void forEachRingCell(int centerColumn, int centerRow, int ring, int columns, int rows, Visit&& visit) {
+        int minRow = std::max(centerRow - ring, 0);
+        int maxRow = std::min(centerRow + ring, rows - 1);
+        int minColumn = std::max(centerColumn - ring, 0);
+        int maxColumn = std::min(centerColumn + ring, columns - 1);
+        for (int row = minRow; row <= maxRow; ++row) {
+            if (row == centerRow - ring || row == centerRow + ring) {
+                for (int column = minColumn; column <= maxColumn; ++column) {
+                    visit(row * columns + column);
+                }
+            }
+            else {
+                if (centerColumn - ring >= 0) {
+                    visit(row * columns + centerColumn - ring);
+                }
+                if (ring != 0 && centerColumn + ring < columns) {
+                    visit(row * columns + centerColumn + ring);
+                }
+            }
+        }
+    }
+
+    // Cell position of a coordinate along one axis, clamped to the grid
+    int cellAlong(float coordinate, float origin, float cellSize, int cellCount) {
+        float cell = std::floor((coordinate - origin) / cellSize);
+        if (!(cell > 0.0f)) {
+            return 0;
+        }
+        return cell < static_cast<float>(cellCount - 1) ? static_cast<int>(cell) : cellCount - 1;
+    }
+
+    // Distance from a coordinate to the span [from, to] along one axis
+    float distanceToSpan(float coordinate, float from, float to) {
+        return coordinate < from ? from - coordinate : coordinate > to ? coordinate - to : 0.0f;
+    }
+}
+
+SpatialHash::SpatialHash(float pointsPerCell)
+    : pointsPerCell(pointsPerCell), originX(0.0f), originY(0.0f), cellSize(1.0f), positionSlack(0.0f),
+    columns(1), rows(1), cellStarts(2, 0) {
+}
+
+int SpatialHash::columnOf(float x) const {
+    return cellAlong(x, originX, cellSize, columns);
+}
+
+int SpatialHash::rowOf(float y) const {
+    return cellAlong(y, originY, cellSize, rows);
+}
+
+void SpatialHash::build(const float* pointX, const float* pointY, int pointCount) {
+    // Lay the grid over the bounding box, with cells large enough to hold pointsPerCell on
+    // average and at least that many along the longer side of a box that is a line
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+    if (pointCount > 0) {
+        minX = *std::min_element(pointX, pointX + pointCount);
+        maxX = *std::max_element(pointX, pointX + pointCount);
+        minY = *std::min_element(pointY, pointY + pointCount);
+        maxY = *std::max_element(pointY, pointY + pointCount);
+    }
+    float width = maxX - minX;
+    float height = maxY - minY;
+    float cellsWanted = std::max(1.0f, pointCount / pointsPerCell);
+    originX = minX;
+    originY = minY;
+    cellSize = std::max(std::sqrt(width * height / cellsWanted), std::max(width, height) / cellsWanted);
+    float magnitude = std::max(std::max(std::abs(minX), std::abs(maxX)), std::max(std::abs(minY), std::abs(maxY)));
+    cellSize = std::max(cellSize, 1e-3f * std::max(1.0f, magnitude));
+    positionSlack = 1e-5f * magnitude + boundSlack * cellSize;
+    columns = static_cast<int>(width / cellSize) + 1;
+    rows = static_cast<int>(height / cellSize) + 1;
+
+    // Counting sort by cell: count, turn the counts into starts, then place the points in
+    // index order so every cell lists its points lowest index first
+    cellStarts.assign(static_cast<std::size_t>(columns) * rows + 1, 0);
+    cellOfPoint.resize(pointCount);
+    for (int i = 0; i < pointCount; ++i) {
+        cellOfPoint[i] = rowOf(pointY[i]) * columns + columnOf(pointX[i]);
+        ++cellStarts[cellOfPoint[i] + 1];
+    }
+    for (std::size_t cell = 1; cell < cellStarts.size(); ++cell) {
+        cellStarts[cell] += cellStarts[cell - 1];
+    }
+
+    sortedX.resize(pointCount);
+    sortedY.resize(pointCount);
+    indices.resize(pointCount);
+    // Each cell's start moves past the points placed in it and ends where the next began,
+    // so shift the starts back by one cell afterwards
+    for (int i = 0; i < pointCount; ++i) {
+        int slot = cellStarts[cellOfPoint[i]]++;
+        sortedX[slot] = pointX[i];
+        sortedY[slot] = pointY[i];
+        indices[slot] = i;
+    }
+    for (std::size_t cell = cellStarts.size() - 1; cell > 0; --cell) {
+        cellStarts[cell] = cellStarts[cell - 1];
+    }
+    cellStarts[0] = 0;
+}
+
+float SpatialHash::distanceBeyondRing(float x, float y, int column, int row, int ring) const {
+    // The cells left are the grid past each side of the ring's square; the nearest of them
+    // is the closest of those strips that still holds cells
+    float gridRight = originX + columns * cellSize;
+    float gridTop = originY + rows * cellSize;
+    float acrossX = distanceToSpan(x, originX, gridRight);
+    float acrossY = distanceToSpan(y, originY, gridTop);
+    float nearest = std::numeric_limits<float>::max();
+    auto consider = [&](float along, float across) {
+        along = std::max(0.0f, along - positionSlack);
+        across = std::max(0.0f, across - positionSlack);
+        nearest = std::min(nearest, (along * along + across * across) * (1.0f - boundSlack));
+    };
+    if (column - ring > 0) {
+        consider(x - (originX + (column - ring) * cellSize), acrossY);
+    }
+    if (column + ring < columns - 1) {
+        consider(originX + (column + ring + 1) * cellSize - x, acrossY);
+    }
+    if (row - ring > 0) {
+        consider(y - (originY + (row - ring) * cellSize), acrossX);
+    }
+    if (row + ring < rows - 1) {
+        consider(originY + (row + ring + 1) * cellSize - y, acrossX);
+    }
+    return nearest;
+}
+
+void SpatialHash::scanCell(int cell, float x, float y, float& best, int& bestIndex) const {
+    int start = cellStarts[cell];
+    int count = cellStarts[cell + 1] - start;
+    if (count >= crowdedCell) {
+        // The kernel takes points up to the best so far and the first of equals, which is the
+        // lowest index in the cell
+        float distance;
+        int nearest = findNearestPoint(x, y, sortedX.data() + start, sortedY.data() + start, count, best, distance);
+        if (nearest != -1 && (bestIndex == -1 || distance < best || indices[start + nearest] < bestIndex)) {
+            best = distance;
+            bestIndex = indices[start + nearest];
+        }
+        return;
+    }
+
+    for (int slot = start; slot < start + count; ++slot) {
+        float dx = sortedX[slot] - x;
+        float dy = sortedY[slot] - y;
+        float distance = dx * dx + dy * dy;
+        if (distance < best || (distance == best && (bestIndex == -1 || indices[slot] < bestIndex))) {
+            best = distance;
+            bestIndex = indices[slot];
+        }
+    }
+}
+
+int SpatialHash::findNearest(float x, float y, float maxSquaredDistance, float& squaredDistance) const {
+    float best = maxSquaredDistance;
+    int bestIndex = -1;
+    int column = columnOf(x);
+    int row = rowOf(y);
+    int lastRing = std::max(std::max(column, columns - 1 - column), std::max(row, rows - 1 - row));
+    for (int ring = 0; ring <= lastRing; ++ring) {
+        forEachRingCell(column, row, ring, columns, rows, [&](int cell) {
+            scanCell(cell, x, y, best, bestIndex);
+        });
+
+        // Once every cell left is beyond the best so far, there is no closer point and no
+        // equal one to break a tie with
+        if (distanceBeyondRing(x, y, column, row, ring) > best) {
+            break;
+        }
+    }
+
+    squaredDistance = bestIndex != -1 ? best : std::numeric_limits<float>::infinity();
+    return bestIndex;
+}
+
+void SpatialHash::findNearestPoints(const float* queryX, const float* queryY, int queryCount, float maxSquaredDistance,
+    int* nearest, float* squaredDistances) const {
+    for (int query = 0; query < queryCount; ++query) {
+        nearest[query] = findNearest(queryX[query], queryY[query], maxSquaredDistance, squaredDistances[query]);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <vector>
+
+// Points bucketed by a uniform grid of square cells, so proximity queries only look at the
+// cells around the query point instead of every point. Each build lays the grid over the
+// bounding box of the points with a few points per cell and fills it in one counting sort,
+// which leaves every cell's points next to each other in index order. Points are reported
+// by their index in the arrays the hash was built from, and every query computes the same
+// float squared distances as the proximity kernels, so both find the same points.
+class SpatialHash {
+public:
+    explicit SpatialHash(float pointsPerCell = 2.0f);
+
+    // Coordinates are expected to be finite
+    void build(const float* pointX, const float* pointY, int pointCount);
+    int size() const { return static_cast<int>(indices.size()); }
+
+    // Same contract and the same answer as findNearestPoint over the arrays the hash was
+    // built from: the closest point at most maxSquaredDistance away, the lowest index on
+    // ties, or -1. Searches outward ring by ring until no closer point can remain.
+    int findNearest(float x, float y, float maxSquaredDistance, float& squaredDistance) const;
+
+    // findNearest for every query point, like findNearestPoints
+    void findNearestPoints(const float* queryX, const float* queryY, int queryCount, float maxSquaredDistance,
+        int* nearest, float* squaredDistances) const;
+
+private:
+    int columnOf(float x) const;
+    int rowOf(float y) const;
+    // Squared distance from (x, y) to the nearest cell outside the given ring around the
+    // cell at column and row, shrunk to stay below the distance of every point there; the
+    // maximum float when the ring covers the grid
+    float distanceBeyondRing(float x, float y, int column, int row, int ring) const;
+    // Scans one cell into best and bestIndex, keeping the lowest index on ties
+    void scanCell(int cell, float x, float y, float& best, int& bestIndex) const;
+
+    float pointsPerCell;
+    float originX;
+    float originY;
+    float cellSize;
+    float positionSlack;          // how far a point can round into a neighbouring cell
+    int columns;
+    int rows;
+    std::vector<int> cellStarts;  // per cell the first of its points, one more entry at the end
+    std::vector<float> sortedX;   // points in cell order
+    std::vector<float> sortedY;
+    std::vector<int> indices;     // per sorted point, its index in the arrays built from
+    std::vector<int> cellOfPoint; // build scratch
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : task(nullptr), taskCount(0), nextIndex(0), busyWorkers(0), generation(0), stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // The caller of parallelFor is one of the threads
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        taskCount = count;
+        nextIndex.store(0, std::memory_order_relaxed);
+        busyWorkers = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+
+    runTasks();
+
+    // The task lives on the caller's stack, so wait until no worker can still be running it
+    std::unique_lock<std::mutex> lock(mutex);
+    workersDone.wait(lock, [&]() { return busyWorkers == 0; });
+    this->task = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    std::uint64_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) {
+            workersDone.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runTasks() {
+    for (std::size_t i = nextIndex.fetch_add(1); i < taskCount; i = nextIndex.fetch_add(1)) {
+        (*task)(i);
+    }
+}
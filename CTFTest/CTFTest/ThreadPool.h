@@ -0,0 +1,47 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed set of worker threads for splitting a tick's independent work, such as a batch of
+// path queries, across cores. Workers sleep between jobs, so an idle pool costs nothing.
+class ThreadPool {
+public:
+    // 0 picks one thread per hardware core, counting the thread that calls parallelFor
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs task(index) for every index below count and returns once all of them finished.
+    // Indices are handed out one at a time, so uneven tasks still balance, and the calling
+    // thread works through them too. Not reentrant: tasks must not call parallelFor.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& task);
+
+    unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+private:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable workersDone;
+    const std::function<void(std::size_t)>* task;
+    std::size_t taskCount;
+    std::atomic<std::size_t> nextIndex;
+    unsigned busyWorkers;
+    std::uint64_t generation;
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,386 @@
+#include "SimulationCore.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Plays many headless matches across all cores to tune the thresholds agents decide by. Every
+// configuration of a grid or of a random sample plays the game's default thresholds, and the
+// configurations race: they play in rounds, and after each round those clearly worse than the
+// best drop out, so the matches go to the ones still in question. Matches come in pairs on
+// the same seed with the sides swapped, and every configuration plays the same seeds, so
+// neither the spawn nor the side tells configurations apart. A match is a function of its
+// seed, which makes the whole run one of the options alone, on any number of threads.
+
+namespace {
+    const int fieldWidth = 800;
+    const int fieldHeight = 600;
+    const int tickMilliseconds = 16;
+
+    struct Settings {
+        int ticks = 4000;
+        int agentCount = 8;
+        int cellSize = 4;
+        std::uint32_t seed = 1;
+        long long expansionBudget = 50000;
+        int threads = 0;
+        int maxMatches = 200;
+        int roundMatches = 20;
+        double z = 1.96;
+        int randomSamples = 0;
+    };
+
+    // A parameter that can be varied, by its name on the command line
+    struct Parameter {
+        const char* name;
+        float BrainParameters::* field;
+    };
+
+    const Parameter parameters[] = {
+        { "proximity", &BrainParameters::proximityThreshold },
+        { "tag-proximity", &BrainParameters::tagProximityThreshold },
+        { "threat", &BrainParameters::threatThreshold },
+        { "grab-flag", &BrainParameters::grabFlagDistance },
+        { "grab-clearance", &BrainParameters::grabEnemyClearance }
+    };
+    const int parameterCount = sizeof(parameters) / sizeof(parameters[0]);
+
+    struct Range {
+        int parameter;
+        float low;
+        float high;
+        int steps;
+    };
+
+    struct Configuration {
+        BrainParameters brain;
+        int matches = 0;
+        int wins = 0;
+        int draws = 0;
+        int losses = 0;
+        int roundsPlayed = 0;
+        bool racing = true;
+
+        // Draws count half, as in a chess score
+        double winRate() const { return matches > 0 ? (wins + 0.5 * draws) / matches : 0.0; }
+    };
+
+    struct Interval {
+        double low;
+        double high;
+    };
+
+    void printUsage() {
+        std::cerr << "Usage: BatchRunner [--vary NAME=MIN:MAX[:STEPS]]... [--random N] [--matches N]\n"
+            "                   [--round N] [--z X] [--ticks N] [--agents N] [--cell-size N]\n"
+            "                   [--seed N] [--expansion-budget N] [--threads N]\n"
+            "  --vary              range of a parameter, swept in STEPS values (default: 3).\n"
+            "                      NAME is one of proximity, tag-proximity, threat, grab-flag,\n"
+            "                      grab-clearance; the others keep the game's values\n"
+            "  --random            play N configurations drawn uniformly from the ranges instead\n"
+            "                      of their grid (default: 0, the grid)\n"
+            "  --matches           most matches a configuration plays (default: 200)\n"
+            "  --round             matches per configuration between eliminations, even\n"
+            "                      (default: 20)\n"
+            "  --z                 width of the confidence intervals in standard deviations\n"
+            "                      (default: 1.96, 95%)\n"
+            "  --ticks             ticks per match (default: 4000, a full match)\n"
+            "  --agents            agents on the field, half of them blue (default: 8)\n"
+            "  --cell-size         side of a path cell in pixels (default: 4)\n"
+            "  --seed              seed of the first match pair and of the random sample (default: 1)\n"
+            "  --expansion-budget  node expansions per tick for the batched searches, 0 for the\n"
+            "                      game's time budget, which is not deterministic (default: 50000)\n"
+            "  --threads           matches played at once, 0 for one per core (default: 0)\n";
+    }
+
+    // NAME=MIN:MAX[:STEPS], false when it does not parse
+    bool parseRange(const std::string& text, Range& range) {
+        std::size_t equals = text.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string name = text.substr(0, equals);
+        range.parameter = -1;
+        for (int i = 0; i < parameterCount; ++i) {
+            if (name == parameters[i].name) {
+                range.parameter = i;
+            }
+        }
+        range.steps = 3;
+        const char* cursor = text.c_str() + equals + 1;
+        char* end = nullptr;
+        range.low = std::strtof(cursor, &end);
+        if (end == cursor || *end != ':') {
+            return false;
+        }
+        cursor = end + 1;
+        range.high = std::strtof(cursor, &end);
+        if (end == cursor) {
+            return false;
+        }
+        if (*end == ':') {
+            cursor = end + 1;
+            range.steps = static_cast<int>(std::strtol(cursor, &end, 10));
+            if (end == cursor) {
+                return false;
+            }
+        }
+        return range.parameter != -1 && *end == '\0' && range.steps >= 1 && range.low <= range.high;
+    }
+
+    // Every combination of the ranges' values, the first range varying slowest
+    std::vector<Configuration> makeGrid(const std::vector<Range>& ranges) {
+        std::vector<Configuration> configurations(1);
+        for (const Range& range : ranges) {
+            std::vector<Configuration> expanded;
+            for (const Configuration& configuration : configurations) {
+                for (int step = 0; step < range.steps; ++step) {
+                    Configuration next = configuration;
+                    float t = range.steps > 1 ? static_cast<float>(step) / (range.steps - 1) : 0.0f;
+                    next.brain.*parameters[range.parameter].field = range.low + t * (range.high - range.low);
+                    expanded.push_back(next);
+                }
+            }
+            configurations.swap(expanded);
+        }
+        return configurations;
+    }
+
+    // Scaled rather than drawn through a standard distribution, whose output differs between
+    // standard libraries, so the same seed samples the same configurations everywhere
+    std::vector<Configuration> makeRandomSample(const std::vector<Range>& ranges, int count, std::uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::vector<Configuration> configurations(count);
+        for (Configuration& configuration : configurations) {
+            for (const Range& range : ranges) {
+                float t = static_cast<float>(rng() * (1.0 / 4294967296.0));
+                configuration.brain.*parameters[range.parameter].field = range.low + t * (range.high - range.low);
+            }
+        }
+        return configurations;
+    }
+
+    // Wilson score interval of a rate seen over n matches
+    Interval wilsonInterval(double rate, int n, double z) {
+        if (n == 0) {
+            return { 0.0, 1.0 };
+        }
+        double z2 = z * z;
+        double denominator = 1.0 + z2 / n;
+        double centre = (rate + z2 / (2.0 * n)) / denominator;
+        double halfWidth = z / denominator * std::sqrt(rate * (1.0 - rate) / n + z2 / (4.0 * n * n));
+        return { std::max(0.0, centre - halfWidth), std::min(1.0, centre + halfWidth) };
+    }
+
+    // One match on the layout HeadlessMatch plays, with the candidate's thresholds on one side
+    // and the opponent's on the other. Returns the candidate's score minus the opponent's.
+    int playMatch(const Settings& settings, const BrainParameters& candidate, const BrainParameters& opponent,
+        bool candidateIsBlue, std::uint32_t seed) {
+        // The match runs on the calling thread, the runner spreads matches over the cores
+        SimulationCore core(fieldWidth, fieldHeight, settings.cellSize, seed, 1);
+        core.setFrameExpansionBudget(static_cast<std::size_t>(settings.expansionBudget));
+        core.setFlagPosition(Team::Blue, { 90.0, 300.0 });
+        core.setFlagPosition(Team::Red, { 730.0, 300.0 });
+        core.setBasePosition(Team::Blue, { 50.0, 280.0 });
+        core.setBasePosition(Team::Red, { 750.0, 280.0 });
+        core.setBrainParameters(Team::Blue, candidateIsBlue ? candidate : opponent);
+        core.setBrainParameters(Team::Red, candidateIsBlue ? opponent : candidate);
+
+        int blueCount = settings.agentCount / 2;
+        for (int i = 0; i < settings.agentCount; ++i) {
+            int x = core.randomBounded(100);
+            int y = core.randomBounded(500);
+            core.addAgent(i < blueCount ? Team::Blue : Team::Red,
+                { i < blueCount ? static_cast<double>(x) : 800.0 - x, static_cast<double>(y) });
+        }
+
+        for (int tick = 0; tick < settings.ticks; ++tick) {
+            core.step(tickMilliseconds);
+        }
+
+        int margin = core.getScore(Team::Blue) - core.getScore(Team::Red);
+        return candidateIsBlue ? margin : -margin;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    std::vector<Range> ranges;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--vary" && hasValue) {
+            Range range;
+            if (!parseRange(argv[++i], range)) {
+                std::cerr << "Bad range: " << argv[i] << "\n";
+                printUsage();
+                return 2;
+            }
+            ranges.push_back(range);
+        }
+        else if (argument == "--random" && hasValue) {
+            settings.randomSamples = std::atoi(argv[++i]);
+        }
+        else if (argument == "--matches" && hasValue) {
+            settings.maxMatches = std::atoi(argv[++i]);
+        }
+        else if (argument == "--round" && hasValue) {
+            settings.roundMatches = std::atoi(argv[++i]);
+        }
+        else if (argument == "--z" && hasValue) {
+            settings.z = std::atof(argv[++i]);
+        }
+        else if (argument == "--ticks" && hasValue) {
+            settings.ticks = std::atoi(argv[++i]);
+        }
+        else if (argument == "--agents" && hasValue) {
+            settings.agentCount = std::atoi(argv[++i]);
+        }
+        else if (argument == "--cell-size" && hasValue) {
+            settings.cellSize = std::atoi(argv[++i]);
+        }
+        else if (argument == "--seed" && hasValue) {
+            settings.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (argument == "--expansion-budget" && hasValue) {
+            settings.expansionBudget = std::atoll(argv[++i]);
+        }
+        else if (argument == "--threads" && hasValue) {
+            settings.threads = std::atoi(argv[++i]);
+        }
+        else {
+            printUsage();
+            return argument == "--help" ? 0 : 2;
+        }
+    }
+    if (settings.randomSamples < 0 || settings.maxMatches < 2 || settings.roundMatches < 2 || settings.roundMatches % 2 != 0
+        || settings.z <= 0.0 || settings.ticks < 0 || settings.agentCount < 0 || settings.cellSize < 1
+        || settings.expansionBudget < 0 || settings.threads < 0) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<Configuration> configurations = settings.randomSamples > 0
+        ? makeRandomSample(ranges, settings.randomSamples, settings.seed)
+        : makeGrid(ranges);
+    const BrainParameters opponent;
+
+    ThreadPool pool(static_cast<unsigned>(settings.threads));
+    std::printf("configurations %zu agents %d ticks %d cell-size %d threads %u\n", configurations.size(),
+        settings.agentCount, settings.ticks, settings.cellSize, pool.getThreadCount());
+
+    // A job is one match of one configuration still racing
+    struct Job {
+        int configuration;
+        int match;
+        int margin;
+    };
+    std::vector<Job> jobs;
+    int totalMatches = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int round = 1; ; ++round) {
+        jobs.clear();
+        for (int c = 0; c < static_cast<int>(configurations.size()); ++c) {
+            Configuration& configuration = configurations[c];
+            if (!configuration.racing) {
+                continue;
+            }
+            int first = configuration.matches;
+            int last = std::min(settings.maxMatches, first + settings.roundMatches);
+            for (int match = first; match < last; ++match) {
+                jobs.push_back({ c, match, 0 });
+            }
+        }
+        if (jobs.empty()) {
+            break;
+        }
+
+        pool.parallelFor(jobs.size(), [&](std::size_t i) {
+            Job& job = jobs[i];
+            // Pairs of matches share a seed, the candidate playing blue in the first
+            bool candidateIsBlue = job.match % 2 == 0;
+            std::uint32_t seed = settings.seed + static_cast<std::uint32_t>(job.match / 2);
+            job.margin = playMatch(settings, configurations[job.configuration].brain, opponent, candidateIsBlue, seed);
+            });
+
+        for (const Job& job : jobs) {
+            Configuration& configuration = configurations[job.configuration];
+            ++configuration.matches;
+            configuration.wins += job.margin > 0;
+            configuration.draws += job.margin == 0;
+            configuration.losses += job.margin < 0;
+            configuration.roundsPlayed = round;
+        }
+        totalMatches += static_cast<int>(jobs.size());
+
+        // Drop every configuration whose interval lies wholly below that of the best so far
+        double bestLow = 0.0;
+        for (const Configuration& configuration : configurations) {
+            if (configuration.racing) {
+                bestLow = std::max(bestLow, wilsonInterval(configuration.winRate(), configuration.matches, settings.z).low);
+            }
+        }
+        int racing = 0;
+        for (Configuration& configuration : configurations) {
+            if (!configuration.racing) {
+                continue;
+            }
+            if (wilsonInterval(configuration.winRate(), configuration.matches, settings.z).high < bestLow) {
+                configuration.racing = false;
+            }
+            else if (configuration.matches >= settings.maxMatches) {
+                configuration.racing = false;
+            }
+            else {
+                ++racing;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("round %d: %zu matches, %d configurations racing, %.1f s\n", round, jobs.size(), racing, seconds);
+        // A lone configuration plays all its matches, a race ends with its last runner
+        if (racing == 0 || (racing == 1 && configurations.size() > 1)) {
+            break;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Best first, by the lower end of the interval so a lucky short run does not come out ahead
+    std::vector<int> ranking(configurations.size());
+    for (int c = 0; c < static_cast<int>(ranking.size()); ++c) {
+        ranking[c] = c;
+    }
+    std::stable_sort(ranking.begin(), ranking.end(), [&](int a, int b) {
+        return wilsonInterval(configurations[a].winRate(), configurations[a].matches, settings.z).low
+            > wilsonInterval(configurations[b].winRate(), configurations[b].matches, settings.z).low;
+        });
+
+    std::printf("%4s", "rank");
+    for (const Parameter& parameter : parameters) {
+        std::printf(" %14s", parameter.name);
+    }
+    std::printf(" %7s %5s %5s %5s %8s %15s %6s\n", "matches", "won", "drawn", "lost", "win rate", "interval", "rounds");
+    for (int rank = 0; rank < static_cast<int>(ranking.size()); ++rank) {
+        const Configuration& configuration = configurations[ranking[rank]];
+        Interval interval = wilsonInterval(configuration.winRate(), configuration.matches, settings.z);
+        std::printf("%4d", rank + 1);
+        for (const Parameter& parameter : parameters) {
+            std::printf(" %14.2f", configuration.brain.*parameter.field);
+        }
+        std::printf(" %7d %5d %5d %5d %8.3f  [%.3f, %.3f] %6d\n", configuration.matches, configuration.wins,
+            configuration.draws, configuration.losses, configuration.winRate(), interval.low, interval.high,
+            configuration.roundsPlayed);
+    }
+
+    std::printf("%d matches in %.3f s, %.1f matches/min\n", totalMatches, seconds,
+        seconds > 0.0 ? totalMatches * 60.0 / seconds : 0.0);
+    return 0;
+}
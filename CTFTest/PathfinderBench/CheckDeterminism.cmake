@@ -0,0 +1,43 @@
+# Plays the same HeadlessMatch on every given thread count and SIMD level and fails unless
+# all of the runs end on the same final state and trajectory hashes. Run by ctest:
+#   cmake -DMATCH=path/to/HeadlessMatch "-DMATCH_ARGS=--seed;7" "-DTHREADS=1;4"
+#         "-DSIMD_LEVELS=scalar;sse2;avx2" -P CheckDeterminism.cmake
+# Levels the machine lacks run on the widest one it has.
+
+if(NOT MATCH)
+    message(FATAL_ERROR "MATCH must name the HeadlessMatch executable")
+endif()
+if(NOT THREADS)
+    set(THREADS 1)
+endif()
+if(NOT SIMD_LEVELS)
+    set(SIMD_LEVELS avx2)
+endif()
+
+set(reference "")
+foreach(threads IN LISTS THREADS)
+    foreach(level IN LISTS SIMD_LEVELS)
+        execute_process(
+            COMMAND ${MATCH} ${MATCH_ARGS} --threads ${threads} --simd ${level}
+            RESULT_VARIABLE result
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE errors)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "HeadlessMatch ${MATCH_ARGS} --threads ${threads} --simd ${level} failed:\n${output}${errors}")
+        endif()
+
+        string(REGEX MATCH "final state [0-9a-f]+ trajectory [0-9a-f]+" hashes "${output}")
+        if(NOT hashes)
+            message(FATAL_ERROR "No hashes in the output of HeadlessMatch:\n${output}")
+        endif()
+        message(STATUS "threads ${threads} simd ${level}: ${hashes}")
+
+        if(reference STREQUAL "")
+            set(reference "${hashes}")
+            set(referenceRun "threads ${threads} simd ${level}")
+        elseif(NOT hashes STREQUAL reference)
+            message(FATAL_ERROR "threads ${threads} simd ${level} played a different match than ${referenceRun}:\n"
+                "  ${hashes}\n  ${reference}")
+        endif()
+    endforeach()
+endforeach()
@@ -0,0 +1,126 @@
+#include "SimulationCore.h"
+#include "SimdSupport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Plays one match on the simulation core without Qt, on the game's default layout, and
+// reports the score and how fast the ticks ran. The game counts its timer down by one per
+// 16 ms tick, so a full match is 4000 ticks. Searches run on an expansion budget by default,
+// which makes the match a function of the seed alone: the trajectory hash folds in the state
+// hash of every tick, so two builds agree on a match exactly when their hashes agree, and
+// so does one build on any number of threads.
+
+namespace {
+    const int fieldWidth = 800;
+    const int fieldHeight = 600;
+    const int tickMilliseconds = 16;
+
+    void printUsage() {
+        std::cerr << "Usage: HeadlessMatch [--ticks N] [--agents N] [--cell-size N] [--seed N]\n"
+            "                     [--expansion-budget N] [--threads N] [--simd LEVEL] [--trace]\n"
+            "  --ticks             ticks to run (default: 4000, a full match)\n"
+            "  --agents            agents on the field, half of them blue (default: 8)\n"
+            "  --cell-size         side of a path cell in pixels (default: 1)\n"
+            "  --seed              seed of the match (default: 1)\n"
+            "  --expansion-budget  node expansions per tick for the batched searches, 0 for the\n"
+            "                      game's time budget, which is not deterministic (default: 50000)\n"
+            "  --threads           threads the tick runs on, 0 for one per core (default: 0)\n"
+            "  --simd              widest vector kernels to use: scalar, sse2 or avx2 (default:\n"
+            "                      the widest the machine supports). All give the same match.\n"
+            "  --trace             print the state hash of every tick\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int ticks = 4000;
+    int agentCount = 8;
+    int cellSize = 1;
+    std::uint32_t seed = 1;
+    long long expansionBudget = 50000;
+    int threads = 0;
+    SimdLevel simdLevel = getSupportedSimdLevel();
+    bool trace = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--ticks" && hasValue) {
+            ticks = std::atoi(argv[++i]);
+        }
+        else if (argument == "--agents" && hasValue) {
+            agentCount = std::atoi(argv[++i]);
+        }
+        else if (argument == "--cell-size" && hasValue) {
+            cellSize = std::atoi(argv[++i]);
+        }
+        else if (argument == "--seed" && hasValue) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (argument == "--expansion-budget" && hasValue) {
+            expansionBudget = std::atoll(argv[++i]);
+        }
+        else if (argument == "--threads" && hasValue) {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (argument == "--simd" && hasValue && parseSimdLevel(argv[i + 1], simdLevel)) {
+            ++i;
+        }
+        else if (argument == "--trace") {
+            trace = true;
+        }
+        else {
+            printUsage();
+            return argument == "--help" ? 0 : 2;
+        }
+    }
+    if (ticks < 0 || agentCount < 0 || cellSize < 1 || expansionBudget < 0 || threads < 0) {
+        printUsage();
+        return 2;
+    }
+
+    simdLevel = setSimdLevel(simdLevel);
+
+    // The layout of GameManager::resetSimulation: flags in the centre of the team zones
+    SimulationCore core(fieldWidth, fieldHeight, cellSize, seed, static_cast<unsigned>(threads));
+    core.setFrameExpansionBudget(static_cast<std::size_t>(expansionBudget));
+    core.setFlagPosition(Team::Blue, { 90.0, 300.0 });
+    core.setFlagPosition(Team::Red, { 730.0, 300.0 });
+    core.setBasePosition(Team::Blue, { 50.0, 280.0 });
+    core.setBasePosition(Team::Red, { 750.0, 280.0 });
+
+    // Spawn as GameManager::runTestCase2 does, blue on the left edge and red on the right
+    int blueCount = agentCount / 2;
+    for (int i = 0; i < agentCount; ++i) {
+        int x = core.randomBounded(100);
+        int y = core.randomBounded(500);
+        core.addAgent(i < blueCount ? Team::Blue : Team::Red,
+            { i < blueCount ? static_cast<double>(x) : 800.0 - x, static_cast<double>(y) });
+    }
+
+    // FNV-1a over the per-tick state hashes
+    std::uint64_t trajectoryHash = 14695981039346656037ull;
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; ++tick) {
+        core.step(tickMilliseconds);
+        std::uint64_t stateHash = core.getStateHash();
+        for (int byte = 0; byte < 8; ++byte) {
+            trajectoryHash = (trajectoryHash ^ ((stateHash >> (8 * byte)) & 0xff)) * 1099511628211ull;
+        }
+        if (trace) {
+            std::printf("tick %d %016llx\n", tick + 1, static_cast<unsigned long long>(stateHash));
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("ticks %d agents %d cell-size %d simd %s\n", ticks, agentCount, cellSize, getSimdLevelName(simdLevel));
+    std::printf("blue %d red %d\n", core.getScore(Team::Blue), core.getScore(Team::Red));
+    std::printf("final state %016llx trajectory %016llx\n", static_cast<unsigned long long>(core.getStateHash()),
+        static_cast<unsigned long long>(trajectoryHash));
+    std::printf("%.3f s, %.1f ticks/s, %.1f us/tick\n", seconds, seconds > 0.0 ? ticks / seconds : 0.0,
+        ticks > 0 ? seconds * 1e6 / ticks : 0.0);
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include "Pathfinder.h"
+#include "OccupancyGrid.h"
+#include "HierarchicalPathfinder.h"
+#include "FlowField.h"
+#include "IncrementalPlanner.h"
+#include "LandmarkTable.h"
+#include "PathCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Cross-checks every path engine against a reference Dijkstra on random grids, with and
+// without soft-cost overlays. Exact engines must match the optimal cost, the hierarchy must
+// return valid paths within a bound of it, and the incremental structures must agree with
+// fresh searches after the grid changes, and paths from the cache must stay valid for whoever
+// asks after the grid changes. Exits non-zero on the first round with a mismatch.
+//   PathEngineTest [--rounds N] [--seed N]
+
+namespace {
+    const int gridWidth = 120;
+    const int gridHeight = 100;
+    const int clusterSize = 20;
+    const double diagonalLength = 1.4142135623730951;
+    const double unreachable = std::numeric_limits<double>::infinity();
+
+    // Hierarchical routes pass through one transition per free stretch of a cluster border.
+    // Without soft costs they stay within this factor of the optimum (1.65 was the worst of
+    // 1200 random rounds); inside an overlay blob a transition can cost many times the
+    // detour around it, so there they only have to be valid.
+    const double hierarchyCostBound = 2.0;
+
+    using Cell = std::pair<int, int>;
+    using Path = std::vector<Cell>;
+
+    struct Layout {
+        std::vector<Cell> agents;
+        std::vector<std::pair<Cell, float>> overlay;
+    };
+
+    struct Query {
+        Cell start;
+        Cell goal;
+    };
+
+    int failures = 0;
+
+    void fail(int round, const std::string& check, const Query& query, double expected, double actual) {
+        ++failures;
+        std::fprintf(stderr, "round %d %s (%d,%d)->(%d,%d): expected %.6f, got %.6f\n", round, check.c_str(),
+            query.start.first, query.start.second, query.goal.first, query.goal.second, expected, actual);
+    }
+
+    // Costs from float tables and float fields differ from double sums in the last bits
+    bool sameCost(double expected, double actual, double tolerance = 1e-6) {
+        if (expected == unreachable || actual == unreachable) {
+            return expected == actual;
+        }
+        return std::abs(expected - actual) <= tolerance * std::max(1.0, expected);
+    }
+
+    int randomInt(std::mt19937& rng, int low, int high) {
+        return low + static_cast<int>(rng() % static_cast<std::uint32_t>(high - low + 1));
+    }
+
+    bool isPassable(const OccupancyGrid& grid, int x, int y, const Cell& goal) {
+        return grid.isValidPosition(x, y) && ((x == goal.first && y == goal.second) || !grid.isOccupied(x, y));
+    }
+
+    // Cost of a path under the grid search rules: every entered cell costs its step cost,
+    // diagonals sqrt(2) times that and only past two passable cells, the goal is passable
+    // even when occupied. Infinity for an empty path, NaN for one that breaks the rules.
+    double getPathCost(const OccupancyGrid& grid, const Path& path, const Query& query, bool eightConnected) {
+        if (path.empty()) {
+            return unreachable;
+        }
+        if (path.front() != query.start || path.back() != query.goal) {
+            return std::nan("");
+        }
+
+        double cost = 0.0;
+        for (std::size_t i = 1; i < path.size(); ++i) {
+            int x = path[i - 1].first;
+            int y = path[i - 1].second;
+            int dx = path[i].first - x;
+            int dy = path[i].second - y;
+            bool diagonal = dx != 0 && dy != 0;
+            if (std::abs(dx) > 1 || std::abs(dy) > 1 || (dx == 0 && dy == 0) || (diagonal && !eightConnected) ||
+                !isPassable(grid, path[i].first, path[i].second, query.goal)) {
+                return std::nan("");
+            }
+            if (diagonal && (!isPassable(grid, x + dx, y, query.goal) || !isPassable(grid, x, y + dy, query.goal))) {
+                return std::nan("");
+            }
+
+            double step = Pathfinder::getStepCost(grid, grid.toCell(path[i].first, path[i].second));
+            cost += diagonal ? step * diagonalLength : step;
+        }
+        return cost;
+    }
+
+    // Plain Dijkstra under the same rules, the optimum every exact engine has to reach
+    double findReferenceCost(const OccupancyGrid& grid, const Query& query, bool eightConnected) {
+        std::vector<double> distance(static_cast<std::size_t>(gridWidth) * gridHeight, unreachable);
+        using Entry = std::pair<double, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        int startCell = grid.toCell(query.start.first, query.start.second);
+        int goalCell = grid.toCell(query.goal.first, query.goal.second);
+        distance[startCell] = 0.0;
+        open.push({ 0.0, startCell });
+
+        const int dx[] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+        const int dy[] = { 0, -1, 0, 1, -1, -1, 1, 1 };
+        while (!open.empty()) {
+            auto [cost, cell] = open.top();
+            open.pop();
+            if (cell == goalCell) {
+                return cost;
+            }
+            if (cost > distance[cell]) {
+                continue;
+            }
+
+            int x = cell % gridWidth;
+            int y = cell / gridWidth;
+            for (int move = 0; move < (eightConnected ? 8 : 4); ++move) {
+                int newX = x + dx[move];
+                int newY = y + dy[move];
+                if (!isPassable(grid, newX, newY, query.goal)) {
+                    continue;
+                }
+                bool diagonal = move >= 4;
+                if (diagonal && (!isPassable(grid, newX, y, query.goal) || !isPassable(grid, x, newY, query.goal))) {
+                    continue;
+                }
+
+                int neighbor = grid.toCell(newX, newY);
+                double step = Pathfinder::getStepCost(grid, neighbor);
+                double newCost = cost + (diagonal ? step * diagonalLength : step);
+                if (newCost < distance[neighbor]) {
+                    distance[neighbor] = newCost;
+                    open.push({ newCost, neighbor });
+                }
+            }
+        }
+        return unreachable;
+    }
+
+    // Scattered agents, and on overlay rounds soft-cost blobs of cost 1 to 30 over parts of
+    // the field, so both uniform and weighted regions are covered
+    Layout makeLayout(std::mt19937& rng, bool withOverlay) {
+        Layout layout;
+        int agentCount = randomInt(rng, 0, gridWidth * gridHeight / 4);
+        for (int i = 0; i < agentCount; ++i) {
+            layout.agents.push_back({ randomInt(rng, 0, gridWidth - 1), randomInt(rng, 0, gridHeight - 1) });
+        }
+        if (withOverlay) {
+            int blobCount = randomInt(rng, 5, 40);
+            for (int blob = 0; blob < blobCount; ++blob) {
+                int centreX = randomInt(rng, 0, gridWidth - 1);
+                int centreY = randomInt(rng, 0, gridHeight - 1);
+                int radius = randomInt(rng, 2, 10);
+                float cost = static_cast<float>(randomInt(rng, 1, 30));
+                for (int y = std::max(centreY - radius, 0); y <= std::min(centreY + radius, gridHeight - 1); ++y) {
+                    for (int x = std::max(centreX - radius, 0); x <= std::min(centreX + radius, gridWidth - 1); ++x) {
+                        layout.overlay.push_back({ { x, y }, cost });
+                    }
+                }
+            }
+        }
+        return layout;
+    }
+
+    Cell randomFreeCell(std::mt19937& rng, const OccupancyGrid& grid) {
+        for (;;) {
+            Cell cell{ randomInt(rng, 0, gridWidth - 1), randomInt(rng, 0, gridHeight - 1) };
+            if (!grid.isOccupied(cell.first, cell.second)) {
+                return cell;
+            }
+        }
+    }
+
+    // Agents step to a random neighbouring cell, about a tenth of them per epoch
+    void moveAgents(std::mt19937& rng, std::vector<Cell>& agents) {
+        for (Cell& agent : agents) {
+            if (randomInt(rng, 0, 9) == 0) {
+                agent.first = std::clamp(agent.first + randomInt(rng, -1, 1), 0, gridWidth - 1);
+                agent.second = std::clamp(agent.second + randomInt(rng, -1, 1), 0, gridHeight - 1);
+            }
+        }
+    }
+
+    // Exact engines and heuristics, one query each
+    void checkFlatEngines(int round, const OccupancyGrid& grid, const LandmarkTable& landmarks4,
+        const LandmarkTable& landmarks8, const Query& query) {
+        struct Variant {
+            const char* name;
+            PathfinderEngine engine;
+            PathConnectivity connectivity;
+            PathHeuristic heuristic;
+        };
+        const Variant variants[] = {
+            { "dense", PathfinderEngine::DenseAStar, PathConnectivity::Four, PathHeuristic::Manhattan },
+            { "jps", PathfinderEngine::JumpPointSearch, PathConnectivity::Four, PathHeuristic::Manhattan },
+            { "bidirectional", PathfinderEngine::BidirectionalAStar, PathConnectivity::Four, PathHeuristic::Manhattan },
+            { "dense-euclidean", PathfinderEngine::DenseAStar, PathConnectivity::Four, PathHeuristic::Euclidean },
+            { "dense-alt", PathfinderEngine::DenseAStar, PathConnectivity::Four, PathHeuristic::Landmarks },
+            { "dense-8", PathfinderEngine::DenseAStar, PathConnectivity::Eight, PathHeuristic::Octile },
+            { "dense-8-euclidean", PathfinderEngine::DenseAStar, PathConnectivity::Eight, PathHeuristic::Euclidean },
+            { "dense-8-alt", PathfinderEngine::DenseAStar, PathConnectivity::Eight, PathHeuristic::Landmarks }
+        };
+
+        double reference[2] = { findReferenceCost(grid, query, false), findReferenceCost(grid, query, true) };
+        const SearchBounds everywhere{ 0, 0, gridWidth - 1, gridHeight - 1 };
+        for (const Variant& variant : variants) {
+            bool eightConnected = variant.connectivity == PathConnectivity::Eight;
+            Pathfinder pathfinder(gridWidth, gridHeight);
+            pathfinder.setEngine(variant.engine);
+            pathfinder.setConnectivity(variant.connectivity);
+            pathfinder.setHeuristic(variant.heuristic);
+            pathfinder.setLandmarks(eightConnected ? &landmarks8 : &landmarks4);
+
+            Path path = pathfinder.findPath(query.start.first, query.start.second, query.goal.first, query.goal.second,
+                grid, everywhere);
+            double cost = getPathCost(grid, path, query, eightConnected);
+            if (!sameCost(reference[eightConnected], cost)) {
+                fail(round, variant.name, query, reference[eightConnected], cost);
+            }
+        }
+
+        // A budgeted search asked again from the same start resumes its tree until it is done
+        Pathfinder budgeted(gridWidth, gridHeight);
+        SearchBudget budget;
+        budget.maxExpansions = 150;
+        budget.maxTotalExpansions = 0;
+        SuspendedSearch suspended;
+        Path path;
+        for (int slice = 0; slice < gridWidth * gridHeight; ++slice) {
+            path = budgeted.findPath(query.start.first, query.start.second, query.goal.first, query.goal.second, grid,
+                budget, suspended);
+            if (!budgeted.isLastPathPartial()) {
+                break;
+            }
+        }
+        double cost = budgeted.isLastPathPartial() ? std::nan("") : getPathCost(grid, path, query, false);
+        if (!sameCost(reference[0], cost)) {
+            fail(round, "budgeted", query, reference[0], cost);
+        }
+    }
+
+    bool isWithinHierarchyBound(const OccupancyGrid& grid, double reference, double cost) {
+        if (reference == unreachable || cost == unreachable) {
+            return reference == cost;
+        }
+        double bound = grid.hasOverlay() ? unreachable : reference * hierarchyCostBound;
+        return cost >= reference - 1e-6 && cost <= bound;
+    }
+
+    // The hierarchy is not exact: a fully refined route has to be valid and near the optimum,
+    // and following partial routes leg by leg has to reach the goal. Only queries Pathfinder
+    // would hand it are checked, shorter ones stay on the flat search.
+    void checkHierarchy(int round, const OccupancyGrid& grid, HierarchicalPathfinder& hierarchy, const Query& query) {
+        int distance = std::abs(query.goal.first - query.start.first) + std::abs(query.goal.second - query.start.second);
+        if (distance <= hierarchy.getShortQueryDistance()) {
+            return;
+        }
+        double reference = findReferenceCost(grid, query, false);
+        Pathfinder refiner(gridWidth, gridHeight);
+
+        hierarchy.setRefinementHorizon(0);
+        Path path = hierarchy.findPath(query.start.first, query.start.second, query.goal.first, query.goal.second, grid,
+            refiner);
+        double cost = getPathCost(grid, path, query, false);
+        if (!isWithinHierarchyBound(grid, reference, cost)) {
+            fail(round, "hierarchical", query, reference, cost);
+        }
+
+        hierarchy.setRefinementHorizon(2);
+        Query leg = query;
+        Path route;
+        for (int legs = 0; legs < gridWidth * gridHeight; ++legs) {
+            path = hierarchy.findPath(leg.start.first, leg.start.second, query.goal.first, query.goal.second, grid, refiner);
+            if (path.empty() || path.front() != leg.start) {
+                route.clear();
+                break;
+            }
+            route.insert(route.end(), path.begin() + (route.empty() ? 0 : 1), path.end());
+            if (!hierarchy.isLastPathPartial() || path.back() == leg.start) {
+                break;
+            }
+            leg.start = path.back();
+        }
+        cost = getPathCost(grid, route, query, false);
+        if (!isWithinHierarchyBound(grid, reference, cost)) {
+            fail(round, "hierarchical-legs", query, reference, cost);
+        }
+    }
+
+    // A batch must give the same costs as the same queries one at a time
+    void checkBatch(int round, const OccupancyGrid& grid, const std::vector<Query>& queries, ThreadPool& pool) {
+        Pathfinder pathfinder(gridWidth, gridHeight);
+        std::vector<PathQuery> batch;
+        for (const Query& query : queries) {
+            PathQuery pathQuery{ query.start.first, query.start.second, query.goal.first, query.goal.second };
+            pathQuery.bounded = true;
+            pathQuery.bounds = SearchBounds{ 0, 0, gridWidth - 1, gridHeight - 1 };
+            pathQuery.connectivity = PathConnectivity::Eight;
+            pathQuery.heuristic = PathHeuristic::Octile;
+            batch.push_back(pathQuery);
+        }
+        std::vector<PathResult> results = pathfinder.findPaths(batch, grid, pool);
+        for (std::size_t i = 0; i < queries.size(); ++i) {
+            double reference = findReferenceCost(grid, queries[i], true);
+            double cost = getPathCost(grid, results[i].path, queries[i], true);
+            if (!sameCost(reference, cost)) {
+                fail(round, "batch", queries[i], reference, cost);
+            }
+        }
+    }
+
+    // Flow fields and the D* Lite planner keep state across epochs; after every change they
+    // have to agree with the optimum on the grid as it is now
+    void checkIncremental(int round, std::mt19937& rng, OccupancyGrid& grid, std::vector<Cell> agents) {
+        Query query{ randomFreeCell(rng, grid), randomFreeCell(rng, grid) };
+        FlowField field(grid, query.goal.first, query.goal.second);
+        IncrementalPlanner planner(gridWidth, gridHeight, std::numeric_limits<std::size_t>::max());
+
+        for (int epoch = 0; epoch < 8; ++epoch) {
+            if (epoch > 0) {
+                moveAgents(rng, agents);
+                grid.setAgentPositions(agents);
+                field.update();
+                // The start is where the chasing agent stands, the goal may take a step
+                query.start = randomFreeCell(rng, grid);
+                Cell goal{ std::clamp(query.goal.first + randomInt(rng, -1, 1), 0, gridWidth - 1),
+                    std::clamp(query.goal.second + randomInt(rng, -1, 1), 0, gridHeight - 1) };
+                query.goal = grid.isOccupied(goal.first, goal.second) ? query.goal : goal;
+            }
+
+            Query fieldQuery{ query.start, { field.getGoalX(), field.getGoalY() } };
+            double fieldReference = findReferenceCost(grid, fieldQuery, false);
+            double fieldCost = getPathCost(grid, field.tracePath(query.start.first, query.start.second), fieldQuery, false);
+            if (!sameCost(fieldReference, fieldCost, 1e-4)) {
+                fail(round, "flow-field", fieldQuery, fieldReference, fieldCost);
+            }
+
+            // Repairs must leave the same distances a rebuild would
+            FlowField fresh(grid, field.getGoalX(), field.getGoalY());
+            for (int y = 0; y < gridHeight; ++y) {
+                for (int x = 0; x < gridWidth; ++x) {
+                    double repaired = field.getDistance(x, y);
+                    double rebuilt = fresh.getDistance(x, y);
+                    if (!sameCost(rebuilt, repaired, 1e-4)) {
+                        fail(round, "flow-field-repair", Query{ { x, y }, fieldQuery.goal }, rebuilt, repaired);
+                        y = gridHeight;
+                        break;
+                    }
+                }
+            }
+
+            double reference = findReferenceCost(grid, query, false);
+            Path path = planner.findPath(query.start.first, query.start.second, query.goal.first, query.goal.second, grid);
+            double cost = getPathCost(grid, path, query, false);
+            if (!sameCost(reference, cost)) {
+                fail(round, "incremental", query, reference, cost);
+            }
+        }
+    }
+
+    // Searches with four and eight moves share one cache across epochs. Every path has to be
+    // valid on the grid as it is now under the asking search's moves, cached or not.
+    void checkPathCache(int round, std::mt19937& rng, OccupancyGrid& grid, std::vector<Cell> agents,
+        const std::vector<Query>& queries) {
+        PathCache cache;
+        Pathfinder pathfinders[2] = { Pathfinder(gridWidth, gridHeight), Pathfinder(gridWidth, gridHeight) };
+        pathfinders[1].setConnectivity(PathConnectivity::Eight);
+        pathfinders[1].setHeuristic(PathHeuristic::Octile);
+        for (Pathfinder& pathfinder : pathfinders) {
+            pathfinder.setPathCache(&cache);
+        }
+
+        for (int epoch = 0; epoch < 4; ++epoch) {
+            if (epoch > 0) {
+                moveAgents(rng, agents);
+                grid.setAgentPositions(agents);
+            }
+            // Eight moves first, so the four-connected searches would find diagonal paths
+            // under their keys if the moves were not part of them
+            for (int eightConnected = 1; eightConnected >= 0; --eightConnected) {
+                for (const Query& query : queries) {
+                    Path path = pathfinders[eightConnected].findPath(query.start.first, query.start.second,
+                        query.goal.first, query.goal.second, grid);
+                    double reference = findReferenceCost(grid, query, eightConnected != 0);
+                    double cost = getPathCost(grid, path, query, eightConnected != 0);
+                    if (std::isnan(cost) || (cost == unreachable) != (reference == unreachable)) {
+                        fail(round, eightConnected ? "path-cache-8" : "path-cache", query, reference, cost);
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = 40;
+    std::uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--rounds" && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            std::fprintf(stderr, "Usage: PathEngineTest [--rounds N] [--seed N]\n");
+            return argument == "--help" ? 0 : 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    ThreadPool pool(4);
+    const int queriesPerRound = 10;
+    for (int round = 0; round < rounds; ++round) {
+        Layout layout = makeLayout(rng, round % 2 == 1);
+        OccupancyGrid grid(gridWidth, gridHeight, clusterSize);
+        grid.setAgentPositions(layout.agents);
+        for (const auto& cell : layout.overlay) {
+            grid.setOverlayCost(cell.first.first, cell.first.second, cell.second);
+        }
+
+        LandmarkTable landmarks4(gridWidth, gridHeight, PathConnectivity::Four);
+        LandmarkTable landmarks8(gridWidth, gridHeight, PathConnectivity::Eight);
+        const std::vector<Cell> landmarkCells = { { 0, 0 }, { gridWidth - 1, 0 }, { 0, gridHeight - 1 },
+            { gridWidth - 1, gridHeight - 1 }, { gridWidth / 2, gridHeight / 2 } };
+        landmarks4.setLandmarks(landmarkCells);
+        landmarks8.setLandmarks(landmarkCells);
+        landmarks4.sync(grid);
+        landmarks8.sync(grid);
+
+        HierarchicalPathfinder hierarchy(gridWidth, gridHeight, clusterSize);
+        hierarchy.sync(grid);
+
+        std::vector<Query> queries;
+        for (int i = 0; i < queriesPerRound; ++i) {
+            queries.push_back({ randomFreeCell(rng, grid), randomFreeCell(rng, grid) });
+        }
+        for (const Query& query : queries) {
+            checkFlatEngines(round, grid, landmarks4, landmarks8, query);
+            checkHierarchy(round, grid, hierarchy, query);
+        }
+        checkBatch(round, grid, queries, pool);
+        checkIncremental(round, rng, grid, layout.agents);
+        grid.setAgentPositions(layout.agents);
+        checkPathCache(round, rng, grid, layout.agents, queries);
+
+        if (failures > 0) {
+            std::fprintf(stderr, "%d mismatches in round %d of seed %u\n", failures, round, seed);
+            return 1;
+        }
+    }
+
+    std::printf("%d rounds of %d queries: every engine matched the reference\n", rounds, queriesPerRound);
+    return 0;
+}
@@ -0,0 +1,482 @@
+#include "Pathfinder.h"
+#include "OccupancyGrid.h"
+#include "HierarchicalPathfinder.h"
+#include "LandmarkTable.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs the Pathfinder engines over a fixed corpus of queries on the game's 800x600 field and
+// reports latency percentiles, expansion throughput and peak memory for every engine and
+// scenario, as JSON or CSV. Agents occupy one cell each, as on the game's occupancy grid.
+
+namespace {
+    const int fieldWidth = 800;
+    const int fieldHeight = 600;
+    const int warmUpQueries = 5;
+    const std::size_t maxLegsPerQuery = 1000; // a query still partial after this many counts as partial
+
+    struct Query {
+        int startX;
+        int startY;
+        int goalX;
+        int goalY;
+    };
+
+    struct Scenario {
+        std::string name;
+        std::vector<std::pair<int, int>> agents;
+        std::vector<Query> queries;
+        std::vector<std::pair<int, int>> softCells = {}; // overlay cells, each costing softCellCost extra
+    };
+
+    const float softCellCost = 30.0f;
+
+    struct Engine {
+        std::string name;
+        PathfinderEngine engine;
+        bool positionLists; // the original API that scans the agent list instead of a grid
+        bool hierarchical;  // unbounded grid queries through the cluster hierarchy
+        PathConnectivity connectivity = PathConnectivity::Four;
+        PathHeuristic heuristic = PathHeuristic::Manhattan;
+    };
+
+    struct Result {
+        std::string engine;
+        std::string scenario;
+        std::size_t queries = 0;
+        std::size_t found = 0;   // complete paths to the goal
+        std::size_t partial = 0; // queries that never got past a partial path
+        double meanMicroseconds = 0.0;
+        double p50Microseconds = 0.0;
+        double p99Microseconds = 0.0;
+        double maxMicroseconds = 0.0;
+        std::uint64_t expansions = 0;
+        double expansionsPerSecond = 0.0;
+        double meanPathLength = 0.0;
+        std::size_t scratchAllocations = 0;
+        long peakRssKb = 0;       // process high-water mark during the run
+        long peakRssGrowthKb = 0; // of that, what the run added to the resident set before it
+    };
+
+    // The corpus must not depend on the standard library's distributions, so the same seed
+    // gives the same queries everywhere
+    int randomInt(std::mt19937& rng, int low, int high) {
+        return low + static_cast<int>(rng() % static_cast<std::uint32_t>(high - low + 1));
+    }
+
+    // Start in the blue half, finish in the red half
+    Scenario makeOpenField(std::size_t queryCount) {
+        std::mt19937 rng(1);
+        Scenario scenario{ "open-field", {}, {} };
+        for (std::size_t i = 0; i < queryCount; ++i) {
+            scenario.queries.push_back({ randomInt(rng, 0, 99), randomInt(rng, 0, fieldHeight - 1),
+                randomInt(rng, 700, fieldWidth - 1), randomInt(rng, 0, fieldHeight - 1) });
+        }
+        return scenario;
+    }
+
+    // GameManager::runTestCase3: zones in opposite corners, four agents per team in each,
+    // every agent heading for the other team's flag
+    Scenario makeCornerLayout(std::size_t queryCount) {
+        std::mt19937 rng(2);
+        Scenario scenario{ "corner-layout", {}, {} };
+        for (int i = 0; i < 4; ++i) {
+            scenario.agents.push_back({ randomInt(rng, 0, 49), randomInt(rng, 0, 49) });
+            scenario.agents.push_back({ 750 - randomInt(rng, 0, 49), 550 - randomInt(rng, 0, 49) });
+        }
+
+        for (std::size_t i = 0; i < queryCount; ++i) {
+            const std::pair<int, int>& agent = scenario.agents[i % scenario.agents.size()];
+            bool blue = i % 2 == 0;
+            scenario.queries.push_back({ agent.first, agent.second, blue ? 750 : 50, blue ? 550 : 50 });
+        }
+        return scenario;
+    }
+
+    // GameManager::runTestCase2(100): fifty agents spread over each team's edge of the field,
+    // heading for the other team's flag through the crowd around it
+    Scenario makeCrowd(std::size_t queryCount) {
+        std::mt19937 rng(3);
+        Scenario scenario{ "crowd-100", {}, {} };
+        for (int i = 0; i < 50; ++i) {
+            scenario.agents.push_back({ randomInt(rng, 0, 99), randomInt(rng, 0, 499) });
+        }
+        for (int i = 0; i < 50; ++i) {
+            scenario.agents.push_back({ fieldWidth - 1 - randomInt(rng, 0, 99), randomInt(rng, 0, 499) });
+        }
+
+        for (std::size_t i = 0; i < queryCount; ++i) {
+            const std::pair<int, int>& agent = scenario.agents[randomInt(rng, 0, 99)];
+            bool blue = agent.first < fieldWidth / 2;
+            scenario.queries.push_back({ agent.first, agent.second, blue ? 730 : 90, 300 });
+        }
+        return scenario;
+    }
+
+    // Goals walled in by a diamond of agents, so every search floods the whole field first
+    Scenario makeUnreachable(std::size_t queryCount) {
+        std::mt19937 rng(4);
+        Scenario scenario{ "unreachable", {}, {} };
+        std::vector<std::pair<int, int>> goals;
+        for (int i = 0; i < 5; ++i) {
+            int goalX = randomInt(rng, 100, 699);
+            int goalY = randomInt(rng, 100, 499);
+            goals.push_back({ goalX, goalY });
+            const int radius = 3;
+            for (int dx = -radius; dx <= radius; ++dx) {
+                int dy = radius - std::abs(dx);
+                scenario.agents.push_back({ goalX + dx, goalY + dy });
+                if (dy != 0) {
+                    scenario.agents.push_back({ goalX + dx, goalY - dy });
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < queryCount; ++i) {
+            const std::pair<int, int>& goal = goals[i % goals.size()];
+            scenario.queries.push_back({ randomInt(rng, 0, 99), randomInt(rng, 0, fieldHeight - 1), goal.first, goal.second });
+        }
+        return scenario;
+    }
+
+    // Explore picks nearby targets, so most queries are short hops among the default agents
+    Scenario makeExplorationHops(std::size_t queryCount) {
+        std::mt19937 rng(5);
+        Scenario scenario{ "exploration-hops", {}, {} };
+        for (int i = 0; i < 4; ++i) {
+            scenario.agents.push_back({ randomInt(rng, 0, 99), randomInt(rng, 0, 499) });
+            scenario.agents.push_back({ fieldWidth - 1 - randomInt(rng, 0, 99), randomInt(rng, 0, 499) });
+        }
+
+        for (std::size_t i = 0; i < queryCount; ++i) {
+            int startX = randomInt(rng, 0, fieldWidth - 1);
+            int startY = randomInt(rng, 0, fieldHeight - 1);
+            int goalX = std::clamp(startX + randomInt(rng, -40, 40), 0, fieldWidth - 1);
+            int goalY = std::clamp(startY + randomInt(rng, -40, 40), 0, fieldHeight - 1);
+            scenario.queries.push_back({ startX, startY, goalX, goalY });
+        }
+        return scenario;
+    }
+
+    // Soft walls across the field, each with one gap at alternating ends, so the cheap way
+    // from the blue edge to the red one winds through them and Manhattan distance misleads
+    Scenario makeSoftWalls(std::size_t queryCount) {
+        std::mt19937 rng(6);
+        Scenario scenario{ "soft-walls", {}, {}, {} };
+        const int gapHeight = 60;
+        for (int wall = 0; wall < 3; ++wall) {
+            int x = 200 * (wall + 1);
+            bool gapAtTop = wall % 2 == 1;
+            for (int y = 0; y < fieldHeight; ++y) {
+                if (gapAtTop ? y >= gapHeight : y < fieldHeight - gapHeight) {
+                    scenario.softCells.push_back({ x, y });
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < queryCount; ++i) {
+            scenario.queries.push_back({ randomInt(rng, 0, 99), randomInt(rng, 0, fieldHeight - 1),
+                randomInt(rng, 700, fieldWidth - 1), randomInt(rng, 0, fieldHeight - 1) });
+        }
+        return scenario;
+    }
+
+    // Resets the kernel's peak resident set size of this process, where supported
+    void resetPeakRss() {
+#ifdef __linux__
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        clearRefs << "5";
+#endif
+    }
+
+    // Field of /proc/self/status in kB, such as VmRSS or the peak VmHWM since the last reset,
+    // 0 where unknown
+    long readStatusKb(const char* field) {
+#ifdef __linux__
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        std::size_t length = std::strlen(field);
+        while (std::getline(status, line)) {
+            if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':') {
+                return std::strtol(line.c_str() + length + 1, nullptr, 10);
+            }
+        }
+#endif
+        return 0;
+    }
+
+    double percentile(const std::vector<double>& sorted, double fraction) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * sorted.size()));
+        return sorted[std::max<std::size_t>(rank, 1) - 1];
+    }
+
+    Result run(const Engine& engine, const Scenario& scenario) {
+        OccupancyGrid grid(fieldWidth, fieldHeight, 20);
+        grid.setAgentPositions(scenario.agents);
+        for (const auto& cell : scenario.softCells) {
+            grid.setOverlayCost(cell.first, cell.second, softCellCost);
+        }
+        const std::vector<std::pair<int, int>> noEnemies;
+
+        Pathfinder pathfinder(fieldWidth, fieldHeight);
+        pathfinder.setEngine(engine.engine);
+        pathfinder.setConnectivity(engine.connectivity);
+        pathfinder.setHeuristic(engine.heuristic);
+        LandmarkTable landmarks(fieldWidth, fieldHeight, engine.connectivity);
+        if (engine.heuristic == PathHeuristic::Landmarks) {
+            landmarks.setLandmarks({ { 0, 0 }, { fieldWidth - 1, 0 }, { 0, fieldHeight - 1 }, { fieldWidth - 1, fieldHeight - 1 },
+                { 90, 300 }, { 730, 300 }, { 50, 280 }, { 750, 280 } });
+            landmarks.sync(grid);
+            pathfinder.setLandmarks(&landmarks);
+        }
+        HierarchicalPathfinder hierarchy(fieldWidth, fieldHeight, 20);
+        if (engine.hierarchical) {
+            hierarchy.sync(grid);
+            pathfinder.setHierarchy(&hierarchy);
+        }
+
+        auto runQuery = [&](const Query& query) {
+            if (engine.positionLists) {
+                return pathfinder.findPath(query.startX, query.startY, query.goalX, query.goalY, noEnemies, scenario.agents);
+            }
+            if (engine.hierarchical) {
+                return pathfinder.findPath(query.startX, query.startY, query.goalX, query.goalY, grid);
+            }
+            return pathfinder.findPath(query.startX, query.startY, query.goalX, query.goalY, grid,
+                SearchBounds{ 0, 0, fieldWidth - 1, fieldHeight - 1 });
+            };
+
+        // A few untimed queries first, so the thread's search scratch has been sized
+        for (std::size_t i = 0; i < std::min<std::size_t>(warmUpQueries, scenario.queries.size()); ++i) {
+            runQuery(scenario.queries[i]);
+        }
+
+        Result result;
+        result.engine = engine.name;
+        result.scenario = scenario.name;
+        result.queries = scenario.queries.size();
+
+        std::vector<double> latencies;
+        double totalSeconds = 0.0;
+        std::size_t totalLength = 0;
+        std::size_t allocationsBefore = Pathfinder::getThreadAllocationCount();
+        long residentBefore = readStatusKb("VmRSS");
+        resetPeakRss();
+        for (const Query& query : scenario.queries) {
+            // Hierarchical paths are refined a few edges at a time, so a query is only done
+            // once the legs queried from the end of each partial one reach the goal, as an
+            // agent walking them would ask. Each leg starts on the cell the previous one ended.
+            double seconds = 0.0;
+            std::size_t length = 0;
+            bool partial = false;
+            Query leg = query;
+            for (std::size_t legs = 0;; ++legs) {
+                auto start = std::chrono::steady_clock::now();
+                std::vector<std::pair<int, int>> path = runQuery(leg);
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                result.expansions += pathfinder.getLastExpansionCount();
+                if (path.empty()) {
+                    length = 0;
+                    partial = false;
+                    break;
+                }
+
+                length += legs == 0 ? path.size() : path.size() - 1;
+                partial = pathfinder.isLastPathPartial();
+                bool stalled = path.back() == std::make_pair(leg.startX, leg.startY);
+                if (!partial || stalled || legs + 1 == maxLegsPerQuery) {
+                    break;
+                }
+                leg.startX = path.back().first;
+                leg.startY = path.back().second;
+            }
+
+            latencies.push_back(seconds * 1e6);
+            totalSeconds += seconds;
+            if (partial) {
+                ++result.partial;
+            }
+            else if (length > 0) {
+                ++result.found;
+                totalLength += length;
+            }
+        }
+        result.peakRssKb = readStatusKb("VmHWM");
+        result.peakRssGrowthKb = std::max(result.peakRssKb - residentBefore, 0L);
+        result.scratchAllocations = Pathfinder::getThreadAllocationCount() - allocationsBefore;
+
+        std::sort(latencies.begin(), latencies.end());
+        if (!latencies.empty()) {
+            result.meanMicroseconds = totalSeconds * 1e6 / latencies.size();
+            result.p50Microseconds = percentile(latencies, 0.50);
+            result.p99Microseconds = percentile(latencies, 0.99);
+            result.maxMicroseconds = latencies.back();
+        }
+        result.expansionsPerSecond = totalSeconds > 0.0 ? result.expansions / totalSeconds : 0.0;
+        result.meanPathLength = result.found > 0 ? static_cast<double>(totalLength) / result.found : 0.0;
+        return result;
+    }
+
+    void writeJson(std::ostream& out, const std::vector<Result>& results) {
+        out << "{\n  \"field\": { \"width\": " << fieldWidth << ", \"height\": " << fieldHeight << " },\n";
+        out << "  \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << "    { \"engine\": \"" << r.engine << "\", \"scenario\": \"" << r.scenario << "\""
+                << ", \"queries\": " << r.queries << ", \"found\": " << r.found << ", \"partial\": " << r.partial
+                << ", \"meanMicroseconds\": " << r.meanMicroseconds << ", \"p50Microseconds\": " << r.p50Microseconds
+                << ", \"p99Microseconds\": " << r.p99Microseconds << ", \"maxMicroseconds\": " << r.maxMicroseconds
+                << ", \"expansions\": " << r.expansions << ", \"expansionsPerSecond\": " << r.expansionsPerSecond
+                << ", \"meanPathLength\": " << r.meanPathLength << ", \"scratchAllocations\": " << r.scratchAllocations
+                << ", \"peakRssKb\": " << r.peakRssKb << ", \"peakRssGrowthKb\": " << r.peakRssGrowthKb << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    void writeCsv(std::ostream& out, const std::vector<Result>& results) {
+        out << "engine,scenario,queries,found,partial,meanMicroseconds,p50Microseconds,p99Microseconds,maxMicroseconds,"
+            "expansions,expansionsPerSecond,meanPathLength,scratchAllocations,peakRssKb,peakRssGrowthKb\n";
+        for (const Result& r : results) {
+            out << r.engine << "," << r.scenario << "," << r.queries << "," << r.found << "," << r.partial << "," << r.meanMicroseconds << ","
+                << r.p50Microseconds << "," << r.p99Microseconds << "," << r.maxMicroseconds << "," << r.expansions << ","
+                << r.expansionsPerSecond << "," << r.meanPathLength << "," << r.scratchAllocations << "," << r.peakRssKb << ","
+                << r.peakRssGrowthKb << "\n";
+        }
+    }
+
+    // Comma separated list as given on the command line
+    std::vector<std::string> splitList(const std::string& list) {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            items.push_back(item);
+        }
+        return items;
+    }
+
+    bool isSelected(const std::vector<std::string>& selection, const std::string& name) {
+        return selection.empty() || std::find(selection.begin(), selection.end(), name) != selection.end();
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: PathfinderBench [--engine LIST] [--scenario LIST] [--format json|csv] [--output FILE] [--quick]\n"
+            "  engines:   hashmap, dense, jps, bidirectional, hierarchical, dense-8,\n"
+            "             hierarchical-8, dense-alt, dense-8-alt (default: all)\n"
+            "  scenarios: open-field, corner-layout, crowd-100, unreachable, exploration-hops,\n"
+            "             soft-walls (default: all)\n"
+            "  --quick    a tenth of the queries, for smoke runs\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> engineSelection;
+    std::vector<std::string> scenarioSelection;
+    std::string format = "json";
+    std::string outputPath;
+    std::size_t scale = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--engine" && hasValue) {
+            engineSelection = splitList(argv[++i]);
+        }
+        else if (argument == "--scenario" && hasValue) {
+            scenarioSelection = splitList(argv[++i]);
+        }
+        else if (argument == "--format" && hasValue) {
+            format = argv[++i];
+        }
+        else if (argument == "--output" && hasValue) {
+            outputPath = argv[++i];
+        }
+        else if (argument == "--quick") {
+            scale = 1;
+        }
+        else {
+            printUsage();
+            return argument == "--help" ? 0 : 2;
+        }
+    }
+    if (format != "json" && format != "csv") {
+        printUsage();
+        return 2;
+    }
+
+    // Query counts per scenario. Unreachable goals flood the field, which takes the hash map
+    // engine seconds per query, so there are few of them.
+    std::vector<Scenario> scenarios = {
+        makeOpenField(20 * scale),
+        makeCornerLayout(20 * scale),
+        makeCrowd(20 * scale),
+        makeUnreachable(scale),
+        makeExplorationHops(50 * scale),
+        makeSoftWalls(20 * scale)
+    };
+    const std::vector<Engine> engines = {
+        { "hashmap", PathfinderEngine::HashMapAStar, true, false },
+        { "dense", PathfinderEngine::DenseAStar, false, false },
+        { "jps", PathfinderEngine::JumpPointSearch, false, false },
+        { "bidirectional", PathfinderEngine::BidirectionalAStar, false, false },
+        { "hierarchical", PathfinderEngine::DenseAStar, false, true },
+        { "dense-8", PathfinderEngine::DenseAStar, false, false, PathConnectivity::Eight, PathHeuristic::Octile },
+        { "hierarchical-8", PathfinderEngine::DenseAStar, false, true, PathConnectivity::Eight, PathHeuristic::Octile },
+        { "dense-alt", PathfinderEngine::DenseAStar, false, false, PathConnectivity::Four, PathHeuristic::Landmarks },
+        { "dense-8-alt", PathfinderEngine::DenseAStar, false, false, PathConnectivity::Eight, PathHeuristic::Landmarks }
+    };
+
+    std::vector<Result> results;
+    for (const Engine& engine : engines) {
+        if (!isSelected(engineSelection, engine.name)) {
+            continue;
+        }
+        for (const Scenario& scenario : scenarios) {
+            if (!isSelected(scenarioSelection, scenario.name)) {
+                continue;
+            }
+
+            Result result = run(engine, scenario);
+            std::fprintf(stderr, "%-14s %-17s %5zu/%-5zu found  %5zu partial  p50 %10.1f us  p99 %10.1f us  %8.2f M exp/s  peak %7ld kB (+%ld)\n",
+                result.engine.c_str(), result.scenario.c_str(), result.found, result.queries, result.partial, result.p50Microseconds,
+                result.p99Microseconds, result.expansionsPerSecond / 1e6, result.peakRssKb, result.peakRssGrowthKb);
+            results.push_back(result);
+        }
+    }
+    if (results.empty()) {
+        std::cerr << "No engine and scenario matched the selection\n";
+        return 2;
+    }
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath);
+        if (!file) {
+            std::cerr << "Cannot write " << outputPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = outputPath.empty() ? std::cout : file;
+    if (format == "json") {
+        writeJson(out, results);
+    }
+    else {
+        writeCsv(out, results);
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "SpatialHash.h"
+#include "ProximityKernels.h"
+#include "SimdSupport.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Cross-checks the spatial hash against brute force on random point sets, spread out,
+// bunched into clusters, and snapped to a coarse lattice so many distances tie. Nearest
+// point searches must pick the same point at the same distance as the proximity kernels at
+// every SIMD level. Exits non-zero on the first round with a mismatch.
+//   ProximityTest [--rounds N] [--seed N]
+
+namespace {
+    const float fieldWidth = 800.0f;
+    const float fieldHeight = 600.0f;
+
+    struct Points {
+        std::vector<float> x;
+        std::vector<float> y;
+    };
+
+    int failures = 0;
+
+    void fail(int round, const std::string& check, float x, float y, int expected, int actual) {
+        ++failures;
+        std::fprintf(stderr, "round %d %s at (%.3f,%.3f): expected %d, got %d\n", round, check.c_str(), x, y,
+            expected, actual);
+    }
+
+    // Spread over the field and a margin past it, bunched around a few centres, or on a
+    // lattice; round % 3 picks which
+    Points makePoints(std::mt19937& rng, int round, int count) {
+        std::uniform_real_distribution<float> spreadX(-50.0f, fieldWidth + 50.0f);
+        std::uniform_real_distribution<float> spreadY(-50.0f, fieldHeight + 50.0f);
+        std::normal_distribution<float> bunch(0.0f, 30.0f);
+        std::vector<std::pair<float, float>> centres;
+        for (int i = 0; i < 3; ++i) {
+            centres.emplace_back(spreadX(rng), spreadY(rng));
+        }
+
+        Points points;
+        for (int i = 0; i < count; ++i) {
+            float x = spreadX(rng);
+            float y = spreadY(rng);
+            if (round % 3 == 1) {
+                const auto& centre = centres[i % centres.size()];
+                x = centre.first + bunch(rng);
+                y = centre.second + bunch(rng);
+            }
+            else if (round % 3 == 2) {
+                x = std::floor(x / 25.0f) * 25.0f;
+                y = std::floor(y / 25.0f) * 25.0f;
+            }
+            points.x.push_back(x);
+            points.y.push_back(y);
+        }
+        return points;
+    }
+
+    void checkNearest(int round, const SpatialHash& hash, const Points& points, const Points& queries, float maxSquaredDistance) {
+        int count = static_cast<int>(queries.x.size());
+        std::vector<int> nearest(count);
+        std::vector<float> squaredDistances(count);
+        hash.findNearestPoints(queries.x.data(), queries.y.data(), count, maxSquaredDistance, nearest.data(),
+            squaredDistances.data());
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2 }) {
+            setSimdLevel(level);
+            for (int i = 0; i < count; ++i) {
+                float squaredDistance;
+                int expected = findNearestPoint(queries.x[i], queries.y[i], points.x.data(), points.y.data(),
+                    static_cast<int>(points.x.size()), maxSquaredDistance, squaredDistance);
+                if (expected != nearest[i] || (expected != -1 && squaredDistance != squaredDistances[i])) {
+                    fail(round, std::string("nearest ") + getSimdLevelName(getSimdLevel()), queries.x[i], queries.y[i],
+                        expected, nearest[i]);
+                }
+            }
+        }
+        setSimdLevel(SimdLevel::Avx2);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = 300;
+    std::uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--rounds" && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            std::fprintf(stderr, "Usage: ProximityTest [--rounds N] [--seed N]\n");
+            return argument == "--help" ? 0 : 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> spreadX(-100.0f, fieldWidth + 100.0f);
+    std::uniform_real_distribution<float> spreadY(-100.0f, fieldHeight + 100.0f);
+    std::uniform_real_distribution<float> radii(0.0f, 300.0f);
+    const int queriesPerRound = 50;
+    for (int round = 0; round < rounds; ++round) {
+        Points points = makePoints(rng, round, std::uniform_int_distribution<int>(0, 1000)(rng));
+        Points queries = makePoints(rng, round, queriesPerRound);
+        for (int i = 0; i < queriesPerRound / 5; ++i) {
+            queries.x[i] = spreadX(rng);
+            queries.y[i] = spreadY(rng);
+        }
+
+        SpatialHash hash(std::uniform_real_distribution<float>(0.5f, 8.0f)(rng));
+        hash.build(points.x.data(), points.y.data(), static_cast<int>(points.x.size()));
+        float radius = radii(rng);
+        checkNearest(round, hash, points, queries, std::numeric_limits<float>::infinity());
+        checkNearest(round, hash, points, queries, radius * radius);
+
+        if (failures > 0) {
+            std::fprintf(stderr, "%d mismatches in round %d of seed %u\n", failures, round, seed);
+            return 1;
+        }
+    }
+
+    std::printf("%d rounds of %d queries: the spatial hash matched brute force\n", rounds, queriesPerRound);
+    return 0;
+}